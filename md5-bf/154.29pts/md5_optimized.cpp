@@ -1,6 +1,5 @@
 #include <iostream>
 #include <string>
-#include <vector>
 #include <cstdint>
 #include <iomanip>
 #include <sstream>
@@ -9,10 +8,22 @@
 #include <climits>
 #include <cstring>
 #include <array>
+#include <random>
+#include <fstream>
+#include <map>
+#include <set>
+#include <vector>
+#include <algorithm>
 
 #include <immintrin.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
 
 #define SIMD_WIDTH 16
+#define CHUNK_BLOCKS 1024 // SIMD_WIDTH-candidate blocks per claimed range
+#define CHUNK_SIZE ((uint64_t)CHUNK_BLOCKS * SIMD_WIDTH)
 #define F(x, y, z) _mm512_or_si512(_mm512_and_si512(x, y), _mm512_andnot_si512(x, z))
 #define G(x, y, z) _mm512_or_si512(_mm512_and_si512(x, z), _mm512_andnot_si512(z, y))
 #define H(x, y, z) _mm512_xor_si512(x, _mm512_xor_si512(y, z))
@@ -23,6 +34,10 @@
 #define HH(a, b, c, d, x, s, ac) { (a) = _mm512_add_epi32((a), H((b), (c), (d))); (a) = _mm512_add_epi32((a), (x)); (a) = _mm512_add_epi32((a), _mm512_set1_epi32(ac)); (a) = ROTATE_LEFT((a), (s)); (a) = _mm512_add_epi32((a), (b)); }
 #define II(a, b, c, d, x, s, ac) { (a) = _mm512_add_epi32((a), I((b), (c), (d))); (a) = _mm512_add_epi32((a), (x)); (a) = _mm512_add_epi32((a), _mm512_set1_epi32(ac)); (a) = ROTATE_LEFT((a), (s)); (a) = _mm512_add_epi32((a), (b)); }
 
+// The AVX-512 kernels are compiled for AVX-512 whatever -march the file is built with;
+// see the ISA dispatch below.
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx512dq,avx512bw,avx512vl")
 void md5_16x_48_byte(const uint64_t inputs[SIMD_WIDTH][6], uint32_t digests[SIMD_WIDTH][4]) {
     __m512i a, b, c, d;
     __m512i x[16];
@@ -66,16 +81,78 @@ void md5_16x_48_byte(const uint64_t inputs[SIMD_WIDTH][6], uint32_t digests[SIMD
     }
 }
 
+// Candidates from RndGen only vary in words 0,1 / 4,5 / 8,9; words 2,3,6,7,10,11 are
+// always zero and 12..15 are fixed padding. The *C steps fold a constant word into the
+// round constant, so only the six live words are loaded, already in SoA order.
+#define FFC(a, b, c, d, xc, s, ac) { (a) = _mm512_add_epi32((a), F((b), (c), (d))); (a) = _mm512_add_epi32((a), _mm512_set1_epi32((uint32_t)(ac) + (uint32_t)(xc))); (a) = ROTATE_LEFT((a), (s)); (a) = _mm512_add_epi32((a), (b)); }
+#define GGC(a, b, c, d, xc, s, ac) { (a) = _mm512_add_epi32((a), G((b), (c), (d))); (a) = _mm512_add_epi32((a), _mm512_set1_epi32((uint32_t)(ac) + (uint32_t)(xc))); (a) = ROTATE_LEFT((a), (s)); (a) = _mm512_add_epi32((a), (b)); }
+#define HHC(a, b, c, d, xc, s, ac) { (a) = _mm512_add_epi32((a), H((b), (c), (d))); (a) = _mm512_add_epi32((a), _mm512_set1_epi32((uint32_t)(ac) + (uint32_t)(xc))); (a) = ROTATE_LEFT((a), (s)); (a) = _mm512_add_epi32((a), (b)); }
+#define IIC(a, b, c, d, xc, s, ac) { (a) = _mm512_add_epi32((a), I((b), (c), (d))); (a) = _mm512_add_epi32((a), _mm512_set1_epi32((uint32_t)(ac) + (uint32_t)(xc))); (a) = ROTATE_LEFT((a), (s)); (a) = _mm512_add_epi32((a), (b)); }
+
+void md5_16x_48_byte_sparse(const uint32_t live[6][SIMD_WIDTH], uint32_t digests[SIMD_WIDTH][4]) {
+    __m512i a, b, c, d;
+    const __m512i x0 = _mm512_load_si512((const __m512i*)live[0]), x1 = _mm512_load_si512((const __m512i*)live[1]);
+    const __m512i x4 = _mm512_load_si512((const __m512i*)live[2]), x5 = _mm512_load_si512((const __m512i*)live[3]);
+    const __m512i x8 = _mm512_load_si512((const __m512i*)live[4]), x9 = _mm512_load_si512((const __m512i*)live[5]);
+    a = _mm512_set1_epi32(0x67452301); b = _mm512_set1_epi32(0xefcdab89);
+    c = _mm512_set1_epi32(0x98badcfe); d = _mm512_set1_epi32(0x10325476);
+    __m512i A=a, B=b, C=c, D=d;
+    FF(a,b,c,d,x0,7,0xd76aa478); FF(d,a,b,c,x1,12,0xe8c7b756); FFC(c,d,a,b,0,17,0x242070db); FFC(b,c,d,a,0,22,0xc1bdceee);
+    FF(a,b,c,d,x4,7,0xf57c0faf); FF(d,a,b,c,x5,12,0x4787c62a); FFC(c,d,a,b,0,17,0xa8304613); FFC(b,c,d,a,0,22,0xfd469501);
+    FF(a,b,c,d,x8,7,0x698098d8); FF(d,a,b,c,x9,12,0x8b44f7af); FFC(c,d,a,b,0,17,0xffff5bb1); FFC(b,c,d,a,0,22,0x895cd7be);
+    FFC(a,b,c,d,0x80,7,0x6b901122); FFC(d,a,b,c,0,12,0xfd987193); FFC(c,d,a,b,384,17,0xa679438e); FFC(b,c,d,a,0,22,0x49b40821);
+    GG(a,b,c,d,x1,5,0xf61e2562); GGC(d,a,b,c,0,9,0xc040b340); GGC(c,d,a,b,0,14,0x265e5a51); GG(b,c,d,a,x0,20,0xe9b6c7aa);
+    GG(a,b,c,d,x5,5,0xd62f105d); GGC(d,a,b,c,0,9,0x02441453); GGC(c,d,a,b,0,14,0xd8a1e681); GG(b,c,d,a,x4,20,0xe7d3fbc8);
+    GG(a,b,c,d,x9,5,0x21e1cde6); GGC(d,a,b,c,384,9,0xc33707d6); GGC(c,d,a,b,0,14,0xf4d50d87); GG(b,c,d,a,x8,20,0x455a14ed);
+    GGC(a,b,c,d,0,5,0xa9e3e905); GGC(d,a,b,c,0,9,0xfcefa3f8); GGC(c,d,a,b,0,14,0x676f02d9); GGC(b,c,d,a,0x80,20,0x8d2a4c8a);
+    HH(a,b,c,d,x5,4,0xfffa3942); HH(d,a,b,c,x8,11,0x8771f681); HHC(c,d,a,b,0,16,0x6d9d6122); HHC(b,c,d,a,384,23,0xfde5380c);
+    HH(a,b,c,d,x1,4,0xa4beea44); HH(d,a,b,c,x4,11,0x4bdecfa9); HHC(c,d,a,b,0,16,0xf6bb4b60); HHC(b,c,d,a,0,23,0xbebfbc70);
+    HHC(a,b,c,d,0,4,0x289b7ec6); HH(d,a,b,c,x0,11,0xeaa127fa); HHC(c,d,a,b,0,16,0xd4ef3085); HHC(b,c,d,a,0,23,0x04881d05);
+    HH(a,b,c,d,x9,4,0xd9d4d039); HHC(d,a,b,c,0x80,11,0xe6db99e5); HHC(c,d,a,b,0,16,0x1fa27cf8); HHC(b,c,d,a,0,23,0xc4ac5665);
+    II(a,b,c,d,x0,6,0xf4292244); IIC(d,a,b,c,0,10,0x432aff97); IIC(c,d,a,b,384,15,0xab9423a7); II(b,c,d,a,x5,21,0xfc93a039);
+    IIC(a,b,c,d,0x80,6,0x655b59c3); IIC(d,a,b,c,0,10,0x8f0ccc92); IIC(c,d,a,b,0,15,0xffeff47d); II(b,c,d,a,x1,21,0x85845dd1);
+    II(a,b,c,d,x8,6,0x6fa87e4f); IIC(d,a,b,c,0,10,0xfe2ce6e0); IIC(c,d,a,b,0,15,0xa3014314); IIC(b,c,d,a,0,21,0x4e0811a1);
+    II(a,b,c,d,x4,6,0xf7537e82); IIC(d,a,b,c,0,10,0xbd3af235); IIC(c,d,a,b,0,15,0x2ad7d2bb); II(b,c,d,a,x9,21,0xeb86d391);
+    A=_mm512_add_epi32(A,a); B=_mm512_add_epi32(B,b); C=_mm512_add_epi32(C,c); D=_mm512_add_epi32(D,d);
+    alignas(64) uint32_t temp_A[16], temp_B[16], temp_C[16], temp_D[16];
+    _mm512_store_si512((__m512i*)temp_A,A); _mm512_store_si512((__m512i*)temp_B,B);
+    _mm512_store_si512((__m512i*)temp_C,C); _mm512_store_si512((__m512i*)temp_D,D);
+    for (int i=0; i<SIMD_WIDTH; i++) {
+        digests[i][0]=temp_A[i]; digests[i][1]=temp_B[i];
+        digests[i][2]=temp_C[i]; digests[i][3]=temp_D[i];
+    }
+}
+
+#pragma GCC pop_options
+
 namespace XorshiftJump {
     using matrix = std::array<uint64_t, 64>;
+    using lut = std::array<std::array<uint64_t, 256>, 8>;
     uint64_t transform(const matrix& mat, uint64_t state) {
         uint64_t new_state = 0;
         for (int i=0; i<64; ++i) if ((state>>i)&1) new_state ^= mat[i];
         return new_state;
     }
+    // Entry [i][j] is the image of byte j placed at byte position i.
+    void build_lut(const matrix& mat, lut& out) {
+        for (int i = 0; i < 8; ++i) {
+            out[i][0] = 0;
+            for (int j = 1; j < 256; ++j) {
+                out[i][j] = out[i][j & (j - 1)] ^ mat[i * 8 + __builtin_ctz(j)];
+            }
+        }
+    }
+    inline uint64_t transform_lut(const lut& l, uint64_t state) {
+        return l[0][(state >> 0) & 0xFF] ^ l[1][(state >> 8) & 0xFF] ^
+               l[2][(state >> 16) & 0xFF] ^ l[3][(state >> 24) & 0xFF] ^
+               l[4][(state >> 32) & 0xFF] ^ l[5][(state >> 40) & 0xFF] ^
+               l[6][(state >> 48) & 0xFF] ^ l[7][(state >> 56) & 0xFF];
+    }
     matrix multiply(const matrix& a, const matrix& b) {
+        alignas(64) lut b_lut;
+        build_lut(b, b_lut);
         matrix result{};
-        for (int i=0; i<64; ++i) result[i] = transform(b, a[i]);
+        for (int i=0; i<64; ++i) result[i] = transform_lut(b_lut, a[i]);
         return result;
     }
     matrix power(matrix base, uint64_t exp) {
@@ -88,6 +165,24 @@ namespace XorshiftJump {
         }
         return result;
     }
+    // jump[i] is the LUT of M^(2^i). Powers of M commute, so advancing a state by any
+    // n costs one transform_lut per set bit of n: at most 64, with no matrix products.
+    // The 64 tables take 1 MiB and are built by repeated squaring.
+    struct power_table {
+        std::vector<lut> jump;
+        void build(const matrix& m) {
+            jump.resize(64);
+            matrix p = m;
+            for (int i = 0; i < 64; ++i) {
+                build_lut(p, jump[i]);
+                for (int r = 0; r < 64; ++r) p[r] = transform_lut(jump[i], p[r]);
+            }
+        }
+        uint64_t advance(uint64_t state, uint64_t n) const {
+            for (; n != 0; n &= n - 1) state = transform_lut(jump[__builtin_ctzll(n)], state);
+            return state;
+        }
+    };
     matrix get_xorshift_matrix() {
         matrix mat{};
         for (int i=0; i<64; ++i) {
@@ -108,6 +203,16 @@ public:
         out[2] = xorshift64(s_[1]); out[3] = 0;
         out[4] = xorshift64(s_[2]); out[5] = 0;
     }
+    // Fills the six live message words of SIMD_WIDTH consecutive candidates, one row per word.
+    void generate_soa(uint32_t live[6][SIMD_WIDTH]) {
+        for (int i = 0; i < SIMD_WIDTH; ++i) {
+            for (int k = 0; k < 3; ++k) {
+                uint64_t v = xorshift64(s_[k]);
+                live[2 * k][i] = (uint32_t)v;
+                live[2 * k + 1][i] = (uint32_t)(v >> 32);
+            }
+        }
+    }
 private:
     uint64_t xorshift64(uint64_t &state) {
         uint64_t x = state;
@@ -127,73 +232,718 @@ void hex_to_bytes(const std::string& hex, unsigned char* bytes) {
     }
 }
 
-int main() {
-    std::ios_base::sync_with_stdio(false);
-    std::cin.tie(NULL);
+// --- Fallback kernels (AVX2 and portable) ---
+// Same contract as md5_16x_48_byte_sparse for nodes without AVX-512: the AVX2 kernel
+// runs two interleaved 8-lane chains, and the portable one is plain C++ over lane
+// arrays that the compiler vectorizes for whatever baseline ISA it targets. Steps
+// follow the RFC schedule, with constant words folded into the round constant.
+static const uint32_t MD5_K[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+};
 
-    std::string s0_hex, s1_hex, s2_hex;
-    std::cin >> s0_hex >> s1_hex >> s2_hex;
-    uint64_t s0 = hex_to_u64(s0_hex), s1 = hex_to_u64(s1_hex), s2 = hex_to_u64(s2_hex);
+constexpr int md5_word(int i) { return i < 16 ? i : i < 32 ? (5 * i + 1) & 15 : i < 48 ? (3 * i + 5) & 15 : (7 * i) & 15; }
+constexpr int md5_shift(int i) {
+    constexpr int S[4][4] = {{7, 12, 17, 22}, {5, 9, 14, 20}, {4, 11, 16, 23}, {6, 10, 15, 21}};
+    return S[i / 16][i & 3];
+}
+// Row of word w in the generate_soa buffer, or -1 for a constant word.
+constexpr int md5_live_row(int w) { return (w < 12 && (w & 3) < 2) ? (w / 4) * 2 + (w & 1) : -1; }
+constexpr uint32_t md5_fixed_word(int w) { return w == 12 ? 0x80 : w == 14 ? 384 : 0; }
 
-    std::string target_hash_hex;
-    std::cin >> target_hash_hex;
-    alignas(32) unsigned char target_hash_bytes[16];
-    hex_to_bytes(target_hash_hex, target_hash_bytes);
+void md5_16x_48_byte_sparse_portable(const uint32_t live[6][SIMD_WIDTH], uint32_t digests[SIMD_WIDTH][4]) {
+    uint32_t a[SIMD_WIDTH], b[SIMD_WIDTH], c[SIMD_WIDTH], d[SIMD_WIDTH];
+    for (int l = 0; l < SIMD_WIDTH; ++l) { a[l] = 0x67452301; b[l] = 0xefcdab89; c[l] = 0x98badcfe; d[l] = 0x10325476; }
+    #pragma GCC unroll 64
+    for (int i = 0; i < 64; ++i) {
+        const int row = md5_live_row(md5_word(i)), s = md5_shift(i);
+        const uint32_t k = MD5_K[i] + md5_fixed_word(md5_word(i));
+        for (int l = 0; l < SIMD_WIDTH; ++l) {
+            uint32_t f = i < 16 ? (b[l] & c[l]) | (~b[l] & d[l]) : i < 32 ? (d[l] & b[l]) | (~d[l] & c[l])
+                       : i < 48 ? b[l] ^ c[l] ^ d[l] : c[l] ^ (b[l] | ~d[l]);
+            uint32_t t = a[l] + f + k + (row >= 0 ? live[row][l] : 0);
+            a[l] = d[l]; d[l] = c[l]; c[l] = b[l];
+            b[l] += (t << s) | (t >> (32 - s));
+        }
+    }
+    for (int l = 0; l < SIMD_WIDTH; ++l) {
+        digests[l][0] = a[l] + 0x67452301; digests[l][1] = b[l] + 0xefcdab89;
+        digests[l][2] = c[l] + 0x98badcfe; digests[l][3] = d[l] + 0x10325476;
+    }
+}
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+void md5_16x_48_byte_sparse_avx2(const uint32_t live[6][SIMD_WIDTH], uint32_t digests[SIMD_WIDTH][4]) {
+    const __m256i ones = _mm256_set1_epi32(-1);
+    __m256i x[2][6];
+    __m256i a[2], b[2], c[2], d[2];
+    for (int g = 0; g < 2; ++g) {
+        for (int k = 0; k < 6; ++k) x[g][k] = _mm256_load_si256((const __m256i*)&live[k][8 * g]);
+        a[g] = _mm256_set1_epi32(0x67452301); b[g] = _mm256_set1_epi32(0xefcdab89);
+        c[g] = _mm256_set1_epi32(0x98badcfe); d[g] = _mm256_set1_epi32(0x10325476);
+    }
+    #pragma GCC unroll 64
+    for (int i = 0; i < 64; ++i) {
+        const int row = md5_live_row(md5_word(i)), s = md5_shift(i);
+        const __m256i k = _mm256_set1_epi32(MD5_K[i] + md5_fixed_word(md5_word(i)));
+        for (int g = 0; g < 2; ++g) {
+            __m256i f = i < 16 ? _mm256_or_si256(_mm256_and_si256(b[g], c[g]), _mm256_andnot_si256(b[g], d[g]))
+                      : i < 32 ? _mm256_or_si256(_mm256_and_si256(d[g], b[g]), _mm256_andnot_si256(d[g], c[g]))
+                      : i < 48 ? _mm256_xor_si256(b[g], _mm256_xor_si256(c[g], d[g]))
+                      : _mm256_xor_si256(c[g], _mm256_or_si256(b[g], _mm256_xor_si256(d[g], ones)));
+            __m256i t = _mm256_add_epi32(a[g], f);
+            if (row >= 0) t = _mm256_add_epi32(t, x[g][row]);
+            t = _mm256_add_epi32(t, k);
+            t = _mm256_or_si256(_mm256_slli_epi32(t, s), _mm256_srli_epi32(t, 32 - s));
+            a[g] = d[g]; d[g] = c[g]; c[g] = b[g]; b[g] = _mm256_add_epi32(t, b[g]);
+        }
+    }
+    alignas(32) uint32_t temp[4][SIMD_WIDTH];
+    for (int g = 0; g < 2; ++g) {
+        _mm256_store_si256((__m256i*)&temp[0][8 * g], _mm256_add_epi32(a[g], _mm256_set1_epi32(0x67452301)));
+        _mm256_store_si256((__m256i*)&temp[1][8 * g], _mm256_add_epi32(b[g], _mm256_set1_epi32(0xefcdab89)));
+        _mm256_store_si256((__m256i*)&temp[2][8 * g], _mm256_add_epi32(c[g], _mm256_set1_epi32(0x98badcfe)));
+        _mm256_store_si256((__m256i*)&temp[3][8 * g], _mm256_add_epi32(d[g], _mm256_set1_epi32(0x10325476)));
+    }
+    for (int i = 0; i < SIMD_WIDTH; i++) {
+        digests[i][0] = temp[0][i]; digests[i][1] = temp[1][i];
+        digests[i][2] = temp[2][i]; digests[i][3] = temp[3][i];
+    }
+}
+#pragma GCC pop_options
+
+// --- Runtime ISA dispatch ---
+// A binary built for a baseline -march (e.g. -march=x86-64-v2) runs on any node: the
+// AVX-512 kernels above are only called when the CPU has AVX-512, and search_range
+// hashes through md5_kernel, which main points at the best kernel available.
+enum class Isa { Portable, Avx2, Avx512 };
+using Md5Kernel = void (*)(const uint32_t live[6][SIMD_WIDTH], uint32_t digests[SIMD_WIDTH][4]);
+struct KernelChoice { Isa isa; const char* name; Md5Kernel kernel; };
+static const KernelChoice kernel_choices[] = {
+    {Isa::Avx512, "avx512", md5_16x_48_byte_sparse},
+    {Isa::Avx2, "avx2", md5_16x_48_byte_sparse_avx2},
+    {Isa::Portable, "portable", md5_16x_48_byte_sparse_portable},
+};
+Md5Kernel md5_kernel = md5_16x_48_byte_sparse_portable;
+
+Isa detect_isa() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq") &&
+        __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl")) return Isa::Avx512;
+    if (__builtin_cpu_supports("avx2")) return Isa::Avx2;
+    return Isa::Portable;
+}
+
+// --- Thread placement (--placement) and per-thread rates (--thread-stats) ---
+// Hashing is pure ALU work, so two threads on one core's SMT siblings share its vector
+// ports. "cores" runs one thread per physical core; "smt" runs one per hardware thread
+// with siblings on adjacent thread numbers. By default OpenMP places threads freely.
+enum class Placement { Free, Cores, Smt };
+
+// Allowed CPUs of the process, one per physical core or all of them grouped by core.
+std::vector<int> placement_cpus(Placement placement) {
+    cpu_set_t allowed;
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+    std::map<std::pair<int, int>, std::vector<int>> cores; // (package, core) -> CPUs
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (!CPU_ISSET(cpu, &allowed)) continue;
+        auto topology = [cpu](const char* what, int fallback) {
+            std::ifstream in("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/" + what);
+            int id = fallback;
+            in >> id;
+            return id;
+        };
+        cores[{topology("physical_package_id", 0), topology("core_id", cpu)}].push_back(cpu);
+    }
+    std::vector<int> cpus;
+    for (const auto& core : cores) {
+        if (placement == Placement::Cores) cpus.push_back(core.second[0]);
+        else cpus.insert(cpus.end(), core.second.begin(), core.second.end());
+    }
+    return cpus;
+}
+
+std::vector<int> g_thread_cpus; // CPU of OpenMP thread i; empty = free placement
+
+// Sizes the OpenMP team to the placement (OMP_NUM_THREADS still caps it).
+void set_placement(Placement placement) {
+    if (placement == Placement::Free) return;
+    g_thread_cpus = placement_cpus(placement);
+    if ((int)g_thread_cpus.size() > omp_get_max_threads()) g_thread_cpus.resize(omp_get_max_threads());
+    if (!g_thread_cpus.empty()) omp_set_num_threads((int)g_thread_cpus.size());
+}
+
+// Called first in every parallel region: pool threads are reused across regions, but
+// not necessarily under the same thread number, so the pin is re-applied each time.
+inline void pin_thread() {
+    if (g_thread_cpus.empty()) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(g_thread_cpus[omp_get_thread_num() % g_thread_cpus.size()], &set);
+    sched_setaffinity(0, sizeof(set), &set);
+}
+
+struct ThreadRate { int cpu; uint64_t candidates; double seconds; };
+bool g_thread_stats = false;
+std::vector<ThreadRate> g_thread_rates; // last search_range, indexed by thread number
 
+// A slow thread just claims fewer chunks, so the spread between threads shows what
+// each placement costs per thread.
+void print_thread_rates() {
+    double total = 0, slowest = -1, fastest = 0;
+    for (size_t t = 0; t < g_thread_rates.size(); ++t) {
+        const ThreadRate& r = g_thread_rates[t];
+        if (r.seconds <= 0) continue;
+        double rate = r.candidates / r.seconds / 1e6;
+        total += rate;
+        slowest = slowest < 0 ? rate : std::min(slowest, rate);
+        fastest = std::max(fastest, rate);
+        std::cerr << "thread " << t << " cpu " << r.cpu << ": " << r.candidates << " candidates, "
+                  << std::fixed << std::setprecision(2) << rate << " MH/s" << std::defaultfloat << std::endl;
+    }
+    std::cerr << "total " << std::fixed << std::setprecision(2) << total << " MH/s, slowest " << slowest
+              << ", fastest " << fastest << std::defaultfloat << std::endl;
+}
+
+struct Query {
+    uint64_t s0, s1, s2;
+    unsigned char target[16];
+};
+
+// Searches chunks [first_chunk, end_chunk) and returns the smallest matching n, or
+// ULLONG_MAX when the range holds no match.
+uint64_t search_range(const Query& q, const XorshiftJump::power_table& jumps, uint64_t first_chunk, uint64_t end_chunk) {
     std::atomic<uint64_t> min_found_n(ULLONG_MAX);
+    std::atomic<uint64_t> next_chunk(first_chunk);
 
-    XorshiftJump::matrix single_step_mat = XorshiftJump::get_xorshift_matrix();
-    XorshiftJump::matrix thread_jump_mat;
-    XorshiftJump::matrix stride_jump_mat;
+    const uint64_t s0 = jumps.advance(q.s0, first_chunk * CHUNK_SIZE);
+    const uint64_t s1 = jumps.advance(q.s1, first_chunk * CHUNK_SIZE);
+    const uint64_t s2 = jumps.advance(q.s2, first_chunk * CHUNK_SIZE);
 
+    // Threads claim contiguous ranges of CHUNK_SIZE candidates in increasing order.
+    // Once a hit is recorded no range starting past it is claimed, and ranges in
+    // flight stop at the hit, so every earlier candidate is still checked.
+    if (g_thread_stats) g_thread_rates.assign(omp_get_max_threads(), ThreadRate{-1, 0, 0});
     #pragma omp parallel
     {
-        #pragma omp single
-        {
-            int num_threads = omp_get_num_threads();
-            thread_jump_mat = XorshiftJump::power(single_step_mat, SIMD_WIDTH);
-            stride_jump_mat = XorshiftJump::power(thread_jump_mat, num_threads);
+        pin_thread();
+        const double t0 = omp_get_wtime();
+        uint64_t hashed = 0;
+        uint64_t seek_chunk = first_chunk;
+        uint64_t seek_s0 = s0, seek_s1 = s1, seek_s2 = s2;
+
+        alignas(64) uint32_t live_words[6][SIMD_WIDTH];
+        alignas(64) uint32_t hash_output[SIMD_WIDTH][4];
+
+        for (;;) {
+            uint64_t chunk = next_chunk.fetch_add(1, std::memory_order_relaxed);
+            uint64_t current_n_base = chunk * CHUNK_SIZE + 1;
+            if (chunk >= end_chunk || current_n_base >= min_found_n.load(std::memory_order_relaxed)) break;
+            const uint64_t gap = (chunk - seek_chunk) * CHUNK_SIZE;
+            seek_s0 = jumps.advance(seek_s0, gap);
+            seek_s1 = jumps.advance(seek_s1, gap);
+            seek_s2 = jumps.advance(seek_s2, gap);
+            seek_chunk = chunk;
+            RndGen generator(seek_s0, seek_s1, seek_s2);
+            const uint64_t chunk_end = current_n_base + CHUNK_SIZE;
+
+            while (current_n_base < chunk_end && current_n_base < min_found_n.load(std::memory_order_relaxed)) {
+                generator.generate_soa(live_words);
+
+                md5_kernel(live_words, hash_output);
+
+                for (int i = 0; i < SIMD_WIDTH; ++i) {
+                    if (memcmp(hash_output[i], q.target, 16) == 0) {
+                        uint64_t found_n = current_n_base + i;
+                        uint64_t prev_min = min_found_n.load(std::memory_order_relaxed);
+                        while (found_n < prev_min) {
+                            if (min_found_n.compare_exchange_weak(prev_min, found_n)) break;
+                        }
+                    }
+                }
+
+                current_n_base += SIMD_WIDTH;
+                hashed += SIMD_WIDTH;
+            }
         }
+        if (g_thread_stats) g_thread_rates[omp_get_thread_num()] = {sched_getcpu(), hashed, omp_get_wtime() - t0};
+    }
+    return min_found_n.load();
+}
 
-        int thread_id = omp_get_thread_num();
-        
-        XorshiftJump::matrix start_jump_mat = XorshiftJump::power(thread_jump_mat, thread_id);
-        
-        uint64_t s0_block_start = XorshiftJump::transform(start_jump_mat, s0);
-        uint64_t s1_block_start = XorshiftJump::transform(start_jump_mat, s1);
-        uint64_t s2_block_start = XorshiftJump::transform(start_jump_mat, s2);
+// --- Distributed mode ---
+// A coordinator leases ranges of lease_chunks chunks to workers over TCP. Workers
+// seek straight to a lease with the xorshift jump and search it with all their
+// threads. The coordinator keeps the highest contiguous completed chunk in a
+// checkpoint file, so a restarted search resumes from there.
+struct LeaseMsg { Query query; uint64_t first_chunk, num_chunks; };
+struct ResultMsg { uint64_t first_chunk, found_n; };
 
-        uint64_t current_n_base = (uint64_t)thread_id * SIMD_WIDTH + 1;
+bool send_all(int fd, const void* buf, size_t len) {
+    const char* p = (const char*)buf;
+    while (len > 0) {
+        ssize_t w = send(fd, p, len, MSG_NOSIGNAL);
+        if (w <= 0) return false;
+        p += w; len -= w;
+    }
+    return true;
+}
+bool recv_all(int fd, void* buf, size_t len) {
+    char* p = (char*)buf;
+    while (len > 0) {
+        ssize_t r = recv(fd, p, len, 0);
+        if (r <= 0) return false;
+        p += r; len -= r;
+    }
+    return true;
+}
 
-        alignas(64) uint64_t input_buffer[SIMD_WIDTH][6];
-        alignas(64) uint32_t hash_output[SIMD_WIDTH][4];
+int open_socket(const char* host, const char* port, bool listening) {
+    addrinfo hints{}, *res;
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = listening ? AI_PASSIVE : 0;
+    if (getaddrinfo(host, port, &hints, &res) != 0) return -1;
+    int fd = -1;
+    for (addrinfo* ai = res; ai && fd < 0; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) continue;
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        bool ok = listening ? (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && listen(fd, 64) == 0)
+                            : connect(fd, ai->ai_addr, ai->ai_addrlen) == 0;
+        if (!ok) { close(fd); fd = -1; }
+    }
+    freeaddrinfo(res);
+    return fd;
+}
+
+struct Checkpoint {
+    std::string path;
+    void save(const std::string& query_key, uint64_t done_chunks, uint64_t found_n) const {
+        if (path.empty()) return;
+        std::string tmp = path + ".tmp";
+        { std::ofstream out(tmp); out << query_key << " " << done_chunks << " " << found_n << "\n"; }
+        rename(tmp.c_str(), path.c_str());
+    }
+    void load(const std::string& query_key, uint64_t& done_chunks, uint64_t& found_n) const {
+        if (path.empty()) return;
+        std::ifstream in(path);
+        std::string s0, s1, s2, target;
+        uint64_t d, f;
+        if (in >> s0 >> s1 >> s2 >> target >> d >> f && s0 + " " + s1 + " " + s2 + " " + target == query_key) {
+            done_chunks = d; found_n = f;
+        }
+    }
+};
+
+uint64_t run_coordinator(const Query& q, const std::string& query_key, const char* port,
+                         uint64_t lease_chunks, const Checkpoint& checkpoint) {
+    uint64_t done_chunks = 0, min_found_n = ULLONG_MAX;
+    checkpoint.load(query_key, done_chunks, min_found_n);
+    if (min_found_n <= done_chunks * CHUNK_SIZE) return min_found_n;
+
+    int listen_fd = open_socket(nullptr, port, true);
+    if (listen_fd < 0) { std::cerr << "coordinator: cannot listen on port " << port << std::endl; exit(1); }
 
-        while (current_n_base < min_found_n.load(std::memory_order_relaxed)) {
-            RndGen generator(s0_block_start, s1_block_start, s2_block_start);
-            for (int i = 0; i < SIMD_WIDTH; ++i) {
-                generator.generate(input_buffer[i]);
+    uint64_t next_lease = done_chunks;
+    std::set<uint64_t> returned_leases;       // leases of workers that went away
+    std::set<uint64_t> completed_leases;      // finished leases above done_chunks
+    std::map<int, uint64_t> worker_lease;     // fd -> leased first_chunk
+    std::vector<int> idle_workers;
+
+    auto assign = [&](int fd) {
+        uint64_t first;
+        if (!returned_leases.empty()) { first = *returned_leases.begin(); returned_leases.erase(returned_leases.begin()); }
+        else if (next_lease * CHUNK_SIZE + 1 < min_found_n) { first = next_lease; next_lease += lease_chunks; }
+        else { idle_workers.push_back(fd); return; }
+        LeaseMsg msg{q, first, lease_chunks};
+        if (send_all(fd, &msg, sizeof(msg))) worker_lease[fd] = first;
+        else { returned_leases.insert(first); close(fd); }
+    };
+
+    while (min_found_n > done_chunks * CHUNK_SIZE) {
+        std::vector<pollfd> fds{{listen_fd, POLLIN, 0}};
+        for (auto& [fd, lease] : worker_lease) fds.push_back({fd, POLLIN, 0});
+        const size_t first_idle = fds.size();
+        for (int fd : idle_workers) fds.push_back({fd, POLLIN, 0});
+        if (poll(fds.data(), fds.size(), -1) < 0) continue;
+        if (fds[0].revents & POLLIN) {
+            int fd = accept(listen_fd, nullptr, nullptr);
+            if (fd >= 0) assign(fd);
+        }
+        for (size_t i = 1; i < fds.size(); ++i) {
+            if (!fds[i].revents) continue;
+            int fd = fds[i].fd;
+            // A parked worker sends nothing until it gets a lease, so any event is a hangup.
+            if (i >= first_idle) {
+                idle_workers.erase(std::find(idle_workers.begin(), idle_workers.end(), fd));
+                close(fd);
+                continue;
+            }
+            uint64_t lease = worker_lease[fd];
+            worker_lease.erase(fd);
+            ResultMsg res;
+            if (!recv_all(fd, &res, sizeof(res)) || res.first_chunk != lease) {
+                returned_leases.insert(lease);
+                close(fd);
+                continue;
+            }
+            min_found_n = std::min(min_found_n, res.found_n);
+            completed_leases.insert(lease);
+            uint64_t before = done_chunks;
+            while (!completed_leases.empty() && *completed_leases.begin() == done_chunks) {
+                completed_leases.erase(completed_leases.begin());
+                done_chunks += lease_chunks;
             }
+            if (done_chunks != before) checkpoint.save(query_key, done_chunks, min_found_n);
+            assign(fd);
+        }
+        // A worker that was parked may be needed again if a lease came back.
+        while (!idle_workers.empty() && !returned_leases.empty()) {
+            int fd = idle_workers.back(); idle_workers.pop_back();
+            assign(fd);
+        }
+    }
 
-            md5_16x_48_byte(input_buffer, hash_output);
+    for (auto& [fd, lease] : worker_lease) close(fd);
+    for (int fd : idle_workers) close(fd);
+    close(listen_fd);
+    return min_found_n;
+}
 
-            for (int i = 0; i < SIMD_WIDTH; ++i) {
-                if (memcmp(hash_output[i], target_hash_bytes, 16) == 0) {
-                    uint64_t found_n = current_n_base + i;
-                    uint64_t prev_min = min_found_n.load(std::memory_order_relaxed);
-                    while (found_n < prev_min) {
-                        if (min_found_n.compare_exchange_weak(prev_min, found_n)) break;
-                    }
-                }
+void run_worker(const char* host, const char* port, const XorshiftJump::power_table& jumps) {
+    int fd = -1;
+    for (int attempt = 0; attempt < 60 && fd < 0; ++attempt) {
+        fd = open_socket(host, port, false);
+        if (fd < 0) sleep(1);
+    }
+    if (fd < 0) { std::cerr << "worker: cannot connect to " << host << ":" << port << std::endl; exit(1); }
+    LeaseMsg lease;
+    while (recv_all(fd, &lease, sizeof(lease))) {
+        ResultMsg res{lease.first_chunk, search_range(lease.query, jumps, lease.first_chunk, lease.first_chunk + lease.num_chunks)};
+        if (g_thread_stats) print_thread_rates();
+        if (!send_all(fd, &res, sizeof(res))) break;
+    }
+    close(fd);
+}
+
+// --- Kernel throughput benchmark (--bench) ---
+// Each variant hashes a fixed set of candidates in a loop, so kernel cost is measured
+// apart from candidate generation (the "generate-*" rows) and from the search loop.
+// Every thread runs the same number of calls, and the thread count is doubled up to
+// the OpenMP maximum. Rows needing an ISA the CPU lacks are skipped.
+struct BenchVariant {
+    const char* name;
+    int hashes_per_call;
+    uint32_t (*run)(uint64_t calls); // returns a digest fold
+    Isa isa = Isa::Portable;
+};
+
+template <Md5Kernel KERNEL>
+uint32_t bench_sparse(uint64_t calls) {
+    alignas(64) uint32_t live[6][SIMD_WIDTH] = {};
+    alignas(64) uint32_t digests[SIMD_WIDTH][4];
+    uint32_t sink = 0;
+    for (uint64_t c = 0; c < calls; ++c) {
+        live[0][0] = (uint32_t)c;
+        KERNEL(live, digests);
+        sink += digests[0][0] + digests[SIMD_WIDTH - 1][3];
+    }
+    return sink;
+}
+
+static const BenchVariant bench_variants[] = {
+    {"x1-gather", SIMD_WIDTH, [](uint64_t calls) {
+        alignas(64) uint64_t inputs[SIMD_WIDTH][6] = {};
+        alignas(64) uint32_t digests[SIMD_WIDTH][4];
+        uint32_t sink = 0;
+        for (uint64_t c = 0; c < calls; ++c) {
+            inputs[0][0] = c;
+            md5_16x_48_byte(inputs, digests);
+            sink += digests[0][0] + digests[SIMD_WIDTH - 1][3];
+        }
+        return sink;
+    }, Isa::Avx512},
+    {"x1-sparse", SIMD_WIDTH, bench_sparse<md5_16x_48_byte_sparse>, Isa::Avx512},
+    {"x1-sparse-avx2", SIMD_WIDTH, bench_sparse<md5_16x_48_byte_sparse_avx2>, Isa::Avx2},
+    {"x1-sparse-portable", SIMD_WIDTH, bench_sparse<md5_16x_48_byte_sparse_portable>},
+    {"generate-aos", SIMD_WIDTH, [](uint64_t calls) {
+        alignas(64) uint64_t inputs[SIMD_WIDTH][6];
+        RndGen generator(1, 2, 3);
+        uint32_t sink = 0;
+        for (uint64_t c = 0; c < calls; ++c) {
+            for (int i = 0; i < SIMD_WIDTH; ++i) generator.generate(inputs[i]);
+            sink += (uint32_t)inputs[SIMD_WIDTH - 1][4];
+        }
+        return sink;
+    }},
+    {"generate-soa", SIMD_WIDTH, [](uint64_t calls) {
+        alignas(64) uint32_t live[6][SIMD_WIDTH];
+        RndGen generator(1, 2, 3);
+        uint32_t sink = 0;
+        for (uint64_t c = 0; c < calls; ++c) {
+            generator.generate_soa(live);
+            sink += live[5][SIMD_WIDTH - 1];
+        }
+        return sink;
+    }},
+};
+
+void run_benchmark(double seconds_per_run, Isa isa) {
+    std::vector<int> thread_counts;
+    int max_threads = omp_get_max_threads();
+    for (int t = 1; t < max_threads; t *= 2) thread_counts.push_back(t);
+    thread_counts.push_back(max_threads);
+
+    std::cout << "variant,threads,hashes,seconds,ghash_per_s,mhash_per_s_per_thread" << std::endl;
+    for (const BenchVariant& v : bench_variants) {
+        if (v.isa > isa) continue;
+        // Calibrate on one thread so each run takes roughly seconds_per_run.
+        uint64_t calls = 1024;
+        for (;;) {
+            double t0 = omp_get_wtime();
+            volatile uint32_t sink = v.run(calls);
+            (void)sink;
+            double elapsed = omp_get_wtime() - t0;
+            if (elapsed >= seconds_per_run / 4) { calls = (uint64_t)(calls * seconds_per_run / elapsed) + 1; break; }
+            calls *= 4;
+        }
+        for (int threads : thread_counts) {
+            double t0 = omp_get_wtime();
+            #pragma omp parallel num_threads(threads)
+            {
+                pin_thread();
+                volatile uint32_t sink = v.run(calls);
+                (void)sink;
             }
-            
-            s0_block_start = XorshiftJump::transform(stride_jump_mat, s0_block_start);
-            s1_block_start = XorshiftJump::transform(stride_jump_mat, s1_block_start);
-            s2_block_start = XorshiftJump::transform(stride_jump_mat, s2_block_start);
-            current_n_base += (uint64_t)omp_get_num_threads() * SIMD_WIDTH;
+            double elapsed = omp_get_wtime() - t0;
+            double hashes = (double)calls * v.hashes_per_call * threads;
+            std::cout << v.name << "," << threads << "," << (uint64_t)hashes << "," << std::fixed << std::setprecision(4) << elapsed << ","
+                      << hashes / elapsed / 1e9 << "," << hashes / elapsed / 1e6 / threads << std::defaultfloat << std::endl;
         }
     }
+}
 
-    std::cout << min_found_n.load() << std::endl;
+// --- Scalar reference and differential self-test (--selftest) ---
+// A plain RFC 1321 MD5, checked against the RFC test suite first, is the oracle for
+// every SIMD path: each kernel lane is compared on random inputs, and search_range
+// must find a target planted at a random n (and hence a random lane and chunk).
+void md5_scalar(const unsigned char* msg, size_t len, unsigned char out[16]) {
+    static const int S[64] = {7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+                              5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+                              4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+                              6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21};
+    uint32_t h[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+    std::vector<unsigned char> buf(msg, msg + len);
+    buf.push_back(0x80);
+    while (buf.size() % 64 != 56) buf.push_back(0);
+    for (int i = 0; i < 8; ++i) buf.push_back((unsigned char)(((uint64_t)len * 8) >> (8 * i)));
+    for (size_t off = 0; off < buf.size(); off += 64) {
+        uint32_t x[16];
+        for (int j = 0; j < 16; ++j) {
+            const unsigned char* p = &buf[off + 4 * j];
+            x[j] = (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+        }
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
+        for (int i = 0; i < 64; ++i) {
+            uint32_t f; int g;
+            if (i < 16)      { f = (b & c) | (~b & d); g = i; }
+            else if (i < 32) { f = (d & b) | (~d & c); g = (5 * i + 1) % 16; }
+            else if (i < 48) { f = b ^ c ^ d;          g = (3 * i + 5) % 16; }
+            else             { f = c ^ (b | ~d);       g = (7 * i) % 16; }
+            uint32_t t = a + f + MD5_K[i] + x[g];
+            a = d; d = c; c = b;
+            b = b + ((t << S[i]) | (t >> (32 - S[i])));
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+    }
+    memcpy(out, h, 16);
+}
+
+int run_selftest(const XorshiftJump::power_table& jumps, int iterations, Isa isa) {
+    int checks = 0, failures = 0;
+    auto check = [&](bool ok, const std::string& what) {
+        ++checks;
+        if (!ok && failures++ < 20) std::cerr << "selftest FAILED: " << what << std::endl;
+    };
+    auto hex = [](const unsigned char* p, size_t n) {
+        std::ostringstream ss;
+        for (size_t i = 0; i < n; ++i) ss << std::hex << std::setw(2) << std::setfill('0') << (int)p[i];
+        return ss.str();
+    };
+
+    static const char* rfc_suite[][2] = {
+        {"", "d41d8cd98f00b204e9800998ecf8427e"},
+        {"a", "0cc175b9c0f1b6a831c399e269772661"},
+        {"abc", "900150983cd24fb0d6963f7d28e17f72"},
+        {"message digest", "f96b697d7cb7938d525a2f31aaf161d0"},
+        {"abcdefghijklmnopqrstuvwxyz", "c3fcd3d76192e4007dfb496cca67e13b"},
+        {"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789", "d174ab98d277d9f5a5611c2c9f419d9f"},
+        {"12345678901234567890123456789012345678901234567890123456789012345678901234567890", "57edf4a22be3c955ac49da2e2107b67a"},
+    };
+    for (auto& tv : rfc_suite) {
+        unsigned char d[16];
+        md5_scalar((const unsigned char*)tv[0], strlen(tv[0]), d);
+        check(hex(d, 16) == tv[1], std::string("md5_scalar(\"") + tv[0] + "\")");
+    }
+
+    std::mt19937_64 rng(0x5eed);
+    for (int it = 0; it < iterations; ++it) {
+        // Generic kernel on arbitrary 48-byte inputs, including the words RndGen leaves zero.
+        alignas(64) uint64_t inputs[SIMD_WIDTH][6];
+        alignas(64) uint32_t digests[SIMD_WIDTH][4];
+        for (auto& in : inputs) for (auto& w : in) w = rng();
+        if (isa == Isa::Avx512) {
+            md5_16x_48_byte(inputs, digests);
+            for (int lane = 0; lane < SIMD_WIDTH; ++lane) {
+                unsigned char expect[16];
+                md5_scalar((const unsigned char*)inputs[lane], 48, expect);
+                check(memcmp(digests[lane], expect, 16) == 0, "x1-gather lane " + std::to_string(lane));
+            }
+        }
+
+        // Sparse kernels on generator output; the AoS generator gives the reference messages.
+        uint64_t s0 = rng(), s1 = rng(), s2 = rng();
+        for (const KernelChoice& k : kernel_choices) {
+            if (k.isa > isa) continue;
+            RndGen soa_gen(s0, s1, s2), aos_gen(s0, s1, s2);
+            alignas(64) uint32_t live[6][SIMD_WIDTH];
+            soa_gen.generate_soa(live);
+            k.kernel(live, digests);
+            for (int lane = 0; lane < SIMD_WIDTH; ++lane) {
+                uint64_t msg[6];
+                unsigned char expect[16];
+                aos_gen.generate(msg);
+                md5_scalar((const unsigned char*)msg, 48, expect);
+                check(memcmp(digests[lane], expect, 16) == 0, std::string("sparse ") + k.name + " lane " + std::to_string(lane));
+            }
+        }
+
+        // Stream seek: one table jump against n single steps, and jumps composing for large n.
+        uint64_t seek_n = 1 + rng() % (2 * CHUNK_SIZE), msg_words[6];
+        RndGen stepper(s0, s1, s2);
+        for (uint64_t i = 0; i < seek_n; ++i) stepper.generate(msg_words);
+        check(jumps.advance(s0, seek_n) == msg_words[0], "advance n=" + std::to_string(seek_n));
+        uint64_t jump_a = rng() >> 1, jump_b = rng() >> 1;
+        check(jumps.advance(jumps.advance(s0, jump_a), jump_b) == jumps.advance(s0, jump_a + jump_b),
+              "advance composition " + std::to_string(jump_a) + "+" + std::to_string(jump_b));
+
+        // search_range must return the planted n exactly, whatever lane and chunk it falls in.
+        Query q{s0, s1, s2, {}};
+        uint64_t planted = 1 + rng() % (3 * CHUNK_SIZE);
+        RndGen walk(s0, s1, s2);
+        uint64_t msg[6];
+        for (uint64_t n = 0; n < planted; ++n) walk.generate(msg);
+        md5_scalar((const unsigned char*)msg, 48, q.target);
+        Md5Kernel selected = md5_kernel;
+        for (const KernelChoice& k : kernel_choices) {
+            if (k.isa > isa) continue;
+            md5_kernel = k.kernel;
+            std::string tag = std::string(" (") + k.name + ") planted n=" + std::to_string(planted);
+            check(search_range(q, jumps, 0, ULLONG_MAX / CHUNK_SIZE) == planted, "search_range" + tag);
+            uint64_t planted_chunk = (planted - 1) / CHUNK_SIZE;
+            check(search_range(q, jumps, planted_chunk, planted_chunk + 1) == planted, "leased search_range" + tag);
+            check(search_range(q, jumps, planted_chunk + 1, planted_chunk + 2) == ULLONG_MAX, "search_range past" + tag);
+        }
+        md5_kernel = selected;
+    }
+
+    std::cout << "selftest: " << checks - failures << "/" << checks << " checks passed" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    std::ios_base::sync_with_stdio(false);
+    std::cin.tie(NULL);
+
+    static XorshiftJump::power_table jumps;
+    jumps.build(XorshiftJump::get_xorshift_matrix());
+
+    // ./solution                                  search on this node
+    // ./solution --coordinator PORT [--lease CHUNKS] [--checkpoint FILE]
+    // ./solution --worker HOST PORT
+    // ./solution --bench [--bench-time SEC]           kernel throughput as CSV
+    // ./solution --selftest [--iters N]               SIMD paths vs the scalar reference
+    // --isa avx512|avx2|portable                    caps the kernel tier below the detected one
+    // --placement cores|smt                         one pinned thread per physical core / hardware thread
+    // --thread-stats                                per-thread candidate rates on stderr
+    const char* coordinator_port = nullptr;
+    uint64_t lease_chunks = 4096;
+    Checkpoint checkpoint;
+    bool bench = false, selftest = false;
+    double bench_time = 0.2;
+    int selftest_iters = 20;
+    Isa isa = detect_isa();
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--isa") != 0) continue;
+        if (i + 1 == argc) { std::cerr << "--isa needs a value (avx512, avx2 or portable)" << std::endl; return 1; }
+        std::string want = argv[i + 1];
+        if (want != "avx512" && want != "avx2" && want != "portable") {
+            std::cerr << "unknown --isa " << want << " (expected avx512, avx2 or portable)" << std::endl;
+            return 1;
+        }
+        Isa requested = want == "avx512" ? Isa::Avx512 : want == "avx2" ? Isa::Avx2 : Isa::Portable;
+        if (requested > isa) {
+            std::cerr << "--isa " << want << " is not available on this CPU" << std::endl;
+            return 1;
+        }
+        isa = requested;
+    }
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--placement") == 0 && i + 1 < argc) {
+            std::string want = argv[++i];
+            if (want != "cores" && want != "smt") { std::cerr << "unknown --placement " << want << std::endl; return 1; }
+            set_placement(want == "cores" ? Placement::Cores : Placement::Smt);
+        } else if (strcmp(argv[i], "--thread-stats") == 0) g_thread_stats = true;
+    }
+    for (const KernelChoice& k : kernel_choices) {
+        if (k.isa <= isa) { md5_kernel = k.kernel; break; }
+    }
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--worker" && i + 2 < argc) { run_worker(argv[i + 1], argv[i + 2], jumps); return 0; }
+        else if (arg == "--bench") bench = true;
+        else if (arg == "--selftest") selftest = true;
+        else if (arg == "--iters" && i + 1 < argc) selftest_iters = atoi(argv[++i]);
+        else if (arg == "--bench-time" && i + 1 < argc) bench_time = atof(argv[++i]);
+        else if (arg == "--coordinator" && i + 1 < argc) coordinator_port = argv[++i];
+        else if (arg == "--lease" && i + 1 < argc) lease_chunks = std::max(1ULL, strtoull(argv[++i], NULL, 10));
+        else if (arg == "--checkpoint" && i + 1 < argc) checkpoint.path = argv[++i];
+    }
+
+    if (bench) {
+        run_benchmark(bench_time, isa);
+        return 0;
+    }
+    if (selftest) return run_selftest(jumps, selftest_iters, isa);
+
+    std::string s0_hex, s1_hex, s2_hex;
+    std::cin >> s0_hex >> s1_hex >> s2_hex;
+    Query q;
+    q.s0 = hex_to_u64(s0_hex); q.s1 = hex_to_u64(s1_hex); q.s2 = hex_to_u64(s2_hex);
+
+    std::string target_hash_hex;
+    std::cin >> target_hash_hex;
+    hex_to_bytes(target_hash_hex, q.target);
+
+    uint64_t min_found_n;
+    if (coordinator_port) {
+        std::string query_key = s0_hex + " " + s1_hex + " " + s2_hex + " " + target_hash_hex;
+        min_found_n = run_coordinator(q, query_key, coordinator_port, lease_chunks, checkpoint);
+    } else {
+        min_found_n = search_range(q, jumps, 0, ULLONG_MAX / CHUNK_SIZE);
+        if (g_thread_stats) print_thread_rates();
+    }
+
+    std::cout << min_found_n << std::endl;
 
     return 0;
-}
\ No newline at end of file
+}
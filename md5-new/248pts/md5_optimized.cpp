@@ -9,36 +9,61 @@
 #include <climits>
 #include <cstring>
 #include <array>
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include <cmath>
+#include <random>
+#include <fstream>
+#include <map>
+#include <sched.h>
 #include <immintrin.h>
 
 #define SIMD_WIDTH 16
-#define F(x, y, z) _mm512_or_si512(_mm512_and_si512(x, y), _mm512_andnot_si512(x, z))
-#define G(x, y, z) _mm512_or_si512(_mm512_and_si512(x, z), _mm512_andnot_si512(z, y))
-#define H(x, y, z) _mm512_xor_si512(x, _mm512_xor_si512(y, z))
-#define I(x, y, z) _mm512_xor_si512(y, _mm512_or_si512(x, _mm512_xor_si512(z, _mm512_set1_epi32(0xFFFFFFFF))))
+#define CHUNK_SIZE ((uint64_t)16384) // candidates per claimed range, for every interleave factor
 #define ROTATE_LEFT(x, n) _mm512_or_si512(_mm512_slli_epi32(x, n), _mm512_srli_epi32(x, 32 - n))
-#define FF(a, b, c, d, x, s, k) { (a) = _mm512_add_epi32((a), F((b), (c), (d))); (a) = _mm512_add_epi32((a), (x)); (a) = _mm512_add_epi32((a), (k)); (a) = ROTATE_LEFT((a), (s)); (a) = _mm512_add_epi32((a), (b)); }
-#define GG(a, b, c, d, x, s, k) { (a) = _mm512_add_epi32((a), G((b), (c), (d))); (a) = _mm512_add_epi32((a), (x)); (a) = _mm512_add_epi32((a), (k)); (a) = ROTATE_LEFT((a), (s)); (a) = _mm512_add_epi32((a), (b)); }
-#define HH(a, b, c, d, x, s, k) { (a) = _mm512_add_epi32((a), H((b), (c), (d))); (a) = _mm512_add_epi32((a), (x)); (a) = _mm512_add_epi32((a), (k)); (a) = ROTATE_LEFT((a), (s)); (a) = _mm512_add_epi32((a), (b)); }
-#define II(a, b, c, d, x, s, k) { (a) = _mm512_add_epi32((a), I((b), (c), (d))); (a) = _mm512_add_epi32((a), (x)); (a) = _mm512_add_epi32((a), (k)); (a) = ROTATE_LEFT((a), (s)); (a) = _mm512_add_epi32((a), (b)); }
-
-struct MD5_Constants {
-    __m512i A_init, B_init, C_init, D_init;
-    __m512i X12, X13, X14, X15;
-    __m512i target_A, target_B, target_C, target_D;
-    __m512i K[64];
+
+static const uint32_t MD5_K[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
 };
+static const uint32_t MD5_INIT[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
 
 namespace XorshiftJump {
     using matrix = std::array<uint64_t, 64>;
+    using lut = std::array<std::array<uint64_t, 256>, 8>;
     uint64_t transform(const matrix& mat, uint64_t state) {
         uint64_t new_state = 0;
         for (int i=0; i<64; ++i) if ((state>>i)&1) new_state ^= mat[i];
         return new_state;
     }
+    // Four-Russians table: entry [i][j] is the image of byte j placed at byte position i.
+    // Each entry is one XOR away from an already built one, so a table costs 8*256 XORs.
+    void build_lut(const matrix& mat, lut& out) {
+        for (int i = 0; i < 8; ++i) {
+            out[i][0] = 0;
+            for (int j = 1; j < 256; ++j) {
+                out[i][j] = out[i][j & (j - 1)] ^ mat[i * 8 + __builtin_ctz(j)];
+            }
+        }
+    }
+    inline uint64_t transform_lut(const lut& l, uint64_t state) {
+        return l[0][(state >> 0) & 0xFF] ^ l[1][(state >> 8) & 0xFF] ^
+               l[2][(state >> 16) & 0xFF] ^ l[3][(state >> 24) & 0xFF] ^
+               l[4][(state >> 32) & 0xFF] ^ l[5][(state >> 40) & 0xFF] ^
+               l[6][(state >> 48) & 0xFF] ^ l[7][(state >> 56) & 0xFF];
+    }
     matrix multiply(const matrix& a, const matrix& b) {
+        alignas(64) lut b_lut;
+        build_lut(b, b_lut);
         matrix result{};
-        for (int i=0; i<64; ++i) result[i] = transform(b, a[i]);
+        for (int i=0; i<64; ++i) result[i] = transform_lut(b_lut, a[i]);
         return result;
     }
     matrix power(matrix base, uint64_t exp) {
@@ -51,6 +76,24 @@ namespace XorshiftJump {
         }
         return result;
     }
+    // jump[i] is the LUT of M^(2^i). Powers of M commute, so advancing a state by any
+    // n costs one transform_lut per set bit of n: at most 64, with no matrix products.
+    // The 64 tables take 1 MiB and are built by repeated squaring.
+    struct power_table {
+        std::vector<lut> jump;
+        void build(const matrix& m) {
+            jump.resize(64);
+            matrix p = m;
+            for (int i = 0; i < 64; ++i) {
+                build_lut(p, jump[i]);
+                for (int r = 0; r < 64; ++r) p[r] = transform_lut(jump[i], p[r]);
+            }
+        }
+        uint64_t advance(uint64_t state, uint64_t n) const {
+            for (; n != 0; n &= n - 1) state = transform_lut(jump[__builtin_ctzll(n)], state);
+            return state;
+        }
+    };
     matrix get_xorshift_matrix() {
         matrix mat{};
         for (int i=0; i<64; ++i) {
@@ -62,20 +105,8 @@ namespace XorshiftJump {
     }
 }
 
-alignas(64) std::array<std::array<uint64_t, 256>, 8> g_jump_luts;
-void precompute_jump_luts(const XorshiftJump::matrix& jump_matrix) {
-    for (int i = 0; i < 8; ++i) {
-        for (int j = 0; j < 256; ++j) {
-            g_jump_luts[i][j] = XorshiftJump::transform(jump_matrix, (uint64_t)j << (i * 8));
-        }
-    }
-}
-inline uint64_t transform_lut(uint64_t state) {
-    return g_jump_luts[0][(state >> 0) & 0xFF] ^ g_jump_luts[1][(state >> 8) & 0xFF] ^
-           g_jump_luts[2][(state >> 16) & 0xFF] ^ g_jump_luts[3][(state >> 24) & 0xFF] ^
-           g_jump_luts[4][(state >> 32) & 0xFF] ^ g_jump_luts[5][(state >> 40) & 0xFF] ^
-           g_jump_luts[6][(state >> 48) & 0xFF] ^ g_jump_luts[7][(state >> 56) & 0xFF];
-}
+// Seek table for the candidate streams, built once in main and shared by every query.
+XorshiftJump::power_table g_jump_table;
 
 uint64_t hex_to_u64(const std::string& hex) {
     uint64_t res; std::stringstream ss; ss << std::hex << hex; ss >> res; return res;
@@ -92,71 +123,352 @@ inline void xorshift64(uint64_t& state) {
     state = x;
 }
 
-inline void generate_scalar_and_store_vectorized(
-    uint64_t s0_start, uint64_t s1_start, uint64_t s2_start,
-    uint32_t soa0[][SIMD_WIDTH], uint32_t soa1[][SIMD_WIDTH], 
-    uint32_t soa2[][SIMD_WIDTH], uint32_t soa3[][SIMD_WIDTH])
-{
-    alignas(64) uint64_t s_nums[3][SIMD_WIDTH * 4];
+// --- Thread placement (--placement) and per-thread rates (--thread-stats) ---
+// Hashing is pure ALU work, so two threads on one core's SMT siblings share its vector
+// ports. "cores" runs one thread per physical core; "smt" runs one per hardware thread
+// with siblings on adjacent thread numbers (the interleave factor is then tuned with
+// every thread running). By default OpenMP places threads freely.
+enum class Placement { Free, Cores, Smt };
 
-    for(int i=0; i < SIMD_WIDTH * 4; ++i) {
-        xorshift64(s0_start); s_nums[0][i] = s0_start;
-        xorshift64(s1_start); s_nums[1][i] = s1_start;
-        xorshift64(s2_start); s_nums[2][i] = s2_start;
+// Allowed CPUs of the process, one per physical core or all of them grouped by core.
+std::vector<int> placement_cpus(Placement placement) {
+    cpu_set_t allowed;
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+    std::map<std::pair<int, int>, std::vector<int>> cores; // (package, core) -> CPUs
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (!CPU_ISSET(cpu, &allowed)) continue;
+        auto topology = [cpu](const char* what, int fallback) {
+            std::ifstream in("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/" + what);
+            int id = fallback;
+            in >> id;
+            return id;
+        };
+        cores[{topology("physical_package_id", 0), topology("core_id", cpu)}].push_back(cpu);
+    }
+    std::vector<int> cpus;
+    for (const auto& core : cores) {
+        if (placement == Placement::Cores) cpus.push_back(core.second[0]);
+        else cpus.insert(cpus.end(), core.second.begin(), core.second.end());
     }
+    return cpus;
+}
 
-    uint32_t* bufs[4][3] = {
-        {&soa0[0][0], &soa0[4][0], &soa0[8][0]}, {&soa1[0][0], &soa1[4][0], &soa1[8][0]},
-        {&soa2[0][0], &soa2[4][0], &soa2[8][0]}, {&soa3[0][0], &soa3[4][0], &soa3[8][0]}
-    };
-    uint32_t* bufs_hi[4][3] = {
-        {&soa0[1][0], &soa0[5][0], &soa0[9][0]}, {&soa1[1][0], &soa1[5][0], &soa1[9][0]},
-        {&soa2[1][0], &soa2[5][0], &soa2[9][0]}, {&soa3[1][0], &soa3[5][0], &soa3[9][0]}
-    };
+std::vector<int> g_thread_cpus; // CPU of OpenMP thread i; empty = free placement
 
-    for (int stream = 0; stream < 3; ++stream) {
-        for(int buf_idx=0; buf_idx < 4; ++buf_idx) {
-            __m512i vec1 = _mm512_loadu_si512(&s_nums[stream][buf_idx * 16]);
-            __m512i vec2 = _mm512_loadu_si512(&s_nums[stream][buf_idx * 16 + 8]);
-            
-            __m256i lo1 = _mm512_cvtepi64_epi32(vec1);
-            __m256i lo2 = _mm512_cvtepi64_epi32(vec2);
-            __m512i lo_full = _mm512_castsi256_si512(lo1);
-            lo_full = _mm512_inserti64x4(lo_full, lo2, 1);
-            
-            __m256i hi1 = _mm512_cvtepi64_epi32(_mm512_srli_epi64(vec1, 32));
-            __m256i hi2 = _mm512_cvtepi64_epi32(_mm512_srli_epi64(vec2, 32));
-            __m512i hi_full = _mm512_castsi256_si512(hi1);
-            hi_full = _mm512_inserti64x4(hi_full, hi2, 1);
+// Sizes the OpenMP team to the placement (OMP_NUM_THREADS still caps it).
+void set_placement(Placement placement) {
+    if (placement == Placement::Free) return;
+    g_thread_cpus = placement_cpus(placement);
+    if ((int)g_thread_cpus.size() > omp_get_max_threads()) g_thread_cpus.resize(omp_get_max_threads());
+    if (!g_thread_cpus.empty()) omp_set_num_threads((int)g_thread_cpus.size());
+}
+
+// Called first in every parallel region: pool threads are reused across regions, but
+// not necessarily under the same thread number, so the pin is re-applied each time.
+inline void pin_thread() {
+    if (g_thread_cpus.empty()) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(g_thread_cpus[omp_get_thread_num() % g_thread_cpus.size()], &set);
+    sched_setaffinity(0, sizeof(set), &set);
+}
+
+struct ThreadRate { int cpu; uint64_t candidates; double seconds; };
+bool g_thread_stats = false;
+std::vector<ThreadRate> g_thread_rates; // last search, indexed by thread number
+
+// Called by every search just before its parallel region.
+void reset_thread_rates() {
+    if (g_thread_stats) g_thread_rates.assign(omp_get_max_threads(), ThreadRate{-1, 0, 0});
+}
+// Called last in a search region with the candidates this thread hashed since t0.
+inline void record_thread_rate(uint64_t candidates, double t0) {
+    if (g_thread_stats) g_thread_rates[omp_get_thread_num()] = {sched_getcpu(), candidates, omp_get_wtime() - t0};
+}
+// With chunked claiming a slow thread just claims fewer ranges, so the spread
+// between threads shows what each placement costs per thread.
+void print_thread_rates(int query) {
+    double total = 0, slowest = -1, fastest = 0;
+    for (size_t t = 0; t < g_thread_rates.size(); ++t) {
+        const ThreadRate& r = g_thread_rates[t];
+        if (r.seconds <= 0) continue;
+        double rate = r.candidates / r.seconds / 1e6;
+        total += rate;
+        slowest = slowest < 0 ? rate : std::min(slowest, rate);
+        fastest = std::max(fastest, rate);
+        std::cerr << "query " << query << " thread " << t << " cpu " << r.cpu << ": " << r.candidates << " candidates, "
+                  << std::fixed << std::setprecision(2) << rate << " MH/s" << std::defaultfloat << std::endl;
+    }
+    std::cerr << "query " << query << " total " << std::fixed << std::setprecision(2) << total << " MH/s, slowest " << slowest
+              << ", fastest " << fastest << std::defaultfloat << std::endl;
+}
 
-            _mm512_store_si512((__m512i*)bufs[buf_idx][stream], lo_full);
-            _mm512_store_si512((__m512i*)bufs_hi[buf_idx][stream], hi_full);
+// MD5 step schedule: message word and rotation of step i, and where word w of a
+// 48-byte candidate comes from. Only words 0,1 / 4,5 / 8,9 vary; the rest are zero
+// or fixed padding that the kernels fold into the round constant.
+constexpr int md5_word(int i) { return i < 16 ? i : i < 32 ? (5 * i + 1) & 15 : i < 48 ? (3 * i + 5) & 15 : (7 * i) & 15; }
+constexpr int md5_shift(int i) {
+    constexpr int S[4][4] = {{7, 12, 17, 22}, {5, 9, 14, 20}, {4, 11, 16, 23}, {6, 10, 15, 21}};
+    return S[i / 16][i & 3];
+}
+// Row of word w in the live-word buffer, or -1 for a constant word.
+constexpr int md5_live_row(int w) { return (w < 12 && (w & 3) < 2) ? (w / 4) * 2 + (w & 1) : -1; }
+constexpr uint32_t md5_fixed_word(int w) { return w == 12 ? 0x80 : w == 14 ? 384 : 0; }
+
+// --- Compile-time MD5 step generator ---
+// Md5Steps<Vec, GROUPS>::run emits the 64 MD5 steps for GROUPS independent chains,
+// step-major so the chains' dependency latencies overlap. Vec is the vector type and
+// its operations (PortableVec, Ymm and Zmm<TERNLOG> below). The schedule (message
+// word, shift, boolean function, which register plays "a") comes from md5_word /
+// md5_shift at compile time, and the a,b,c,d rotation is done by indexing, not by
+// register moves. The steps are force-inlined and expanded with index_sequence
+// folds, so a kernel built on it compiles to the same straight-line code as steps
+// written out by hand.
+//
+// The generator sits outside the target regions so that every kernel shares it. GCC
+// will not force a target-specific function into it, so the Vec operations and the
+// word/konst/each_chain callbacks are plain inline functions; they are inlined once
+// the steps have landed in a kernel of their own ISA.
+//
+// word(std::integral_constant<int, W>, g) returns message word W of chain g, or
+// Md5Zero when that word is known to be zero (or folded into the constant), in which
+// case its add is not emitted. konst(std::integral_constant<int, I>) returns the
+// round constant of step I.
+//
+// Compiled for the baseline ISA, the generator's bodies call operations that return
+// wider vectors than it has, which GCC flags with an ABI note (-Wpsabi). The note is
+// about calls, and none survive inlining, so it is silenced here.
+struct Md5Zero {};
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+template <class Vec, int GROUPS>
+struct Md5Steps {
+    using V = typename Vec::type;
+
+    // Register that holds state word k (0 = a .. 3 = d) going into step i.
+    static constexpr int reg(int i, int k) { return (4 - i % 4 + k) % 4; }
+
+    template <int I, int G, class Word, class Konst>
+    static inline __attribute__((always_inline)) void chain_step(V s[4][GROUPS], const Word& word, const Konst& konst) {
+        constexpr int A = reg(I, 0), B = reg(I, 1), C = reg(I, 2), D = reg(I, 3);
+        V f;
+        if constexpr (I < 16) f = Vec::f(s[B][G], s[C][G], s[D][G]);
+        else if constexpr (I < 32) f = Vec::g(s[B][G], s[C][G], s[D][G]);
+        else if constexpr (I < 48) f = Vec::h(s[B][G], s[C][G], s[D][G]);
+        else f = Vec::i(s[B][G], s[C][G], s[D][G]);
+        // word + constant is summed on its own, off the critical path through f.
+        V k = konst(std::integral_constant<int, I>{});
+        auto x = word(std::integral_constant<int, md5_word(I)>{}, G);
+        if constexpr (!std::is_same_v<decltype(x), Md5Zero>) k = Vec::add(x, k);
+        V a = Vec::add(Vec::add(f, s[A][G]), k);
+        a = Vec::template rotl<md5_shift(I)>(a);
+        s[A][G] = Vec::add(a, s[B][G]);
+    }
+
+    template <int I, class Word, class Konst, int... G>
+    static inline __attribute__((always_inline)) void step(V s[4][GROUPS], const Word& word, const Konst& konst, std::integer_sequence<int, G...>) {
+        (chain_step<I, G>(s, word, konst), ...);
+    }
+
+    template <int FIRST, class Word, class Konst, int... I>
+    static inline __attribute__((always_inline)) void steps(V s[4][GROUPS], const Word& word, const Konst& konst, std::integer_sequence<int, I...>) {
+        (step<FIRST + I>(s, word, konst, std::make_integer_sequence<int, GROUPS>{}), ...);
+    }
+
+    // s[0..3][g] holds a, b, c, d of chain g; the feed-forward add is left to the caller.
+    template <class Word, class Konst>
+    static inline __attribute__((always_inline)) void run(V s[4][GROUPS], const Word& word, const Konst& konst) {
+        run<0, 64>(s, word, konst);
+    }
+
+    // Steps [FIRST, LAST) only, e.g. to resume from a midstate: word k of chain g is
+    // read from s[reg(FIRST, k)][g] and ends up in s[reg(LAST, k)][g].
+    template <int FIRST, int LAST, class Word, class Konst>
+    static inline __attribute__((always_inline)) void run(V s[4][GROUPS], const Word& word, const Konst& konst) {
+        if constexpr (LAST > FIRST) steps<FIRST>(s, word, konst, std::make_integer_sequence<int, LAST - FIRST>{});
+    }
+
+    // Calls fn(g) for every chain, unrolled like the steps (a plain loop here is only
+    // unrolled late, which changes the scheduling of the whole kernel).
+    template <class Fn, int... G>
+    static inline __attribute__((always_inline)) void each_chain(const Fn& fn, std::integer_sequence<int, G...>) { (fn(G), ...); }
+    template <class Fn>
+    static inline __attribute__((always_inline)) void each_chain(const Fn& fn) { each_chain(fn, std::make_integer_sequence<int, GROUPS>{}); }
+};
+#pragma GCC diagnostic pop
+
+// Plain RFC 1321 MD5: the oracle for --selftest (see run_selftest).
+void md5_scalar(const unsigned char* msg, size_t len, unsigned char out[16]) {
+    static const int S[64] = {7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+                              5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+                              4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+                              6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21};
+    uint32_t h[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+    std::vector<unsigned char> buf(msg, msg + len);
+    buf.push_back(0x80);
+    while (buf.size() % 64 != 56) buf.push_back(0);
+    for (int i = 0; i < 8; ++i) buf.push_back((unsigned char)(((uint64_t)len * 8) >> (8 * i)));
+    for (size_t off = 0; off < buf.size(); off += 64) {
+        uint32_t x[16];
+        for (int j = 0; j < 16; ++j) {
+            const unsigned char* p = &buf[off + 4 * j];
+            x[j] = (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
         }
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
+        for (int i = 0; i < 64; ++i) {
+            uint32_t f; int g;
+            if (i < 16)      { f = (b & c) | (~b & d); g = i; }
+            else if (i < 32) { f = (d & b) | (~d & c); g = (5 * i + 1) % 16; }
+            else if (i < 48) { f = b ^ c ^ d;          g = (3 * i + 5) % 16; }
+            else             { f = c ^ (b | ~d);       g = (7 * i) % 16; }
+            uint32_t t = a + f + MD5_K[i] + x[g];
+            a = d; d = c; c = b;
+            b = b + ((t << S[i]) | (t >> (32 - S[i])));
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d;
     }
+    memcpy(out, h, 16);
 }
 
+// The solver's candidate n: the n-th output of each stream, each zero-padded to 16 bytes.
+void candidate_message(uint64_t s0, uint64_t s1, uint64_t s2, uint64_t n, unsigned char msg[48]) {
+    for (uint64_t i = 0; i < n; ++i) { xorshift64(s0); xorshift64(s1); xorshift64(s2); }
+    memset(msg, 0, 48);
+    memcpy(msg, &s0, 8); memcpy(msg + 16, &s1, 8); memcpy(msg + 32, &s2, 8);
+}
 
-int main() {
-    std::ios_base::sync_with_stdio(false);
-    std::cin.tie(NULL);
+// --- Fallback kernels (AVX2 and portable) ---
+// Nodes without AVX-512 run the same chunked search with a narrower kernel. A kernel
+// hashes `lanes` consecutive candidates given as live[row][lane] (rows as in
+// md5_live_row) and writes digest[word][lane]. Both run Md5Steps: the AVX2 kernel on
+// four chains of __m256i, the portable one on GCC generic vectors as wide as the
+// baseline ISA's registers (four chains of four lanes on plain x86-64).
+// The portable kernel stays out of line so that --bench and --selftest, which are built
+// for AVX-512, run the baseline-ISA code rather than an inlined AVX-512 copy.
+struct Md5PortableKernel {
+    static constexpr int lanes = 16;
+    __attribute__((noinline)) static void hash(const uint32_t live[6][lanes], uint32_t digest[4][lanes]);
+};
+struct Md5Avx2Kernel {
+    static constexpr int lanes = 32; // four interleaved chains of eight
+    static void hash(const uint32_t live[6][lanes], uint32_t digest[4][lanes]);
+};
+
+// Baseline-ISA operations for Md5Steps, on the widest integer vector the build's
+// baseline ISA has.
+struct PortableVec {
+#if defined(__AVX512F__)
+    static constexpr int lanes = 16;
+#elif defined(__AVX2__)
+    static constexpr int lanes = 8;
+#else
+    static constexpr int lanes = 4;
+#endif
+    typedef uint32_t type __attribute__((vector_size(4 * lanes)));
+    static inline type f(type x, type y, type z) { return (x & y) | (~x & z); }
+    static inline type g(type x, type y, type z) { return (z & x) | (~z & y); }
+    static inline type h(type x, type y, type z) { return x ^ y ^ z; }
+    static inline type i(type x, type y, type z) { return y ^ (x | ~z); }
+    static inline type add(type x, type y) { return x + y; }
+    template <int S> static inline type rotl(type x) { return (x << S) | (x >> (32 - S)); }
+};
 
-    MD5_Constants constants;
-    constants.A_init = _mm512_set1_epi32(0x67452301); constants.B_init = _mm512_set1_epi32(0xefcdab89);
-    constants.C_init = _mm512_set1_epi32(0x98badcfe); constants.D_init = _mm512_set1_epi32(0x10325476);
-    constants.X12 = _mm512_set1_epi32(0x80); constants.X13 = _mm512_setzero_si512();
-    constants.X14 = _mm512_set1_epi32(384); constants.X15 = _mm512_setzero_si512();
-    static const uint32_t K_scalar[64] = {
-        0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
-        0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
-        0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
-        0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
-        0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
-        0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
-        0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
-        0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+void Md5PortableKernel::hash(const uint32_t live[6][lanes], uint32_t digest[4][lanes]) {
+    using V = PortableVec::type;
+    constexpr int W = PortableVec::lanes, GROUPS = lanes / W;
+    using Steps = Md5Steps<PortableVec, GROUPS>;
+    V s[4][GROUPS];
+    Steps::each_chain([&](int g) {
+        s[0][g] = V{} + MD5_INIT[0]; s[1][g] = V{} + MD5_INIT[1];
+        s[2][g] = V{} + MD5_INIT[2]; s[3][g] = V{} + MD5_INIT[3];
+    });
+    auto word = [&](auto w, int g) {
+        constexpr int row = md5_live_row(decltype(w)::value);
+        if constexpr (row >= 0) { V x; memcpy(&x, &live[row][W * g], sizeof x); return x; }
+        else return Md5Zero{};
     };
-    for(int j=0; j<64; ++j) { constants.K[j] = _mm512_set1_epi32(K_scalar[j]); }
-    
+    auto konst = [](auto i) {
+        constexpr int step = decltype(i)::value;
+        return V{} + (MD5_K[step] + md5_fixed_word(md5_word(step)));
+    };
+    Steps::run(s, word, konst);
+    Steps::each_chain([&](int g) {
+        for (int k = 0; k < 4; ++k) {
+            V out = s[k][g] + MD5_INIT[k];
+            memcpy(&digest[k][W * g], &out, sizeof out);
+        }
+    });
+}
+
+// Writes the live words of the next Kernel::lanes candidates, advancing the streams.
+template <class Kernel>
+inline void fallback_live_words(uint64_t& s0, uint64_t& s1, uint64_t& s2, uint32_t live[6][Kernel::lanes]) {
+    for (int l = 0; l < Kernel::lanes; ++l) {
+        xorshift64(s0); xorshift64(s1); xorshift64(s2);
+        live[0][l] = (uint32_t)s0; live[1][l] = (uint32_t)(s0 >> 32);
+        live[2][l] = (uint32_t)s1; live[3][l] = (uint32_t)(s1 >> 32);
+        live[4][l] = (uint32_t)s2; live[5][l] = (uint32_t)(s2 >> 32);
+    }
+}
+
+// Chunked search of search_md5_48 around a fallback kernel, with scalar candidate
+// generation and digest compare.
+template <class Kernel>
+uint64_t search_md5_48_fallback(uint64_t s0, uint64_t s1, uint64_t s2, const unsigned char target_hash_bytes[16]) {
+    uint32_t target[4];
+    memcpy(target, target_hash_bytes, 16);
+
+    std::atomic<uint64_t> min_found_n(ULLONG_MAX);
+    std::atomic<uint64_t> next_chunk(0);
+
+    reset_thread_rates();
+    #pragma omp parallel
+    {
+        pin_thread();
+        const double t0 = omp_get_wtime();
+        uint64_t hashed = 0;
+        uint64_t seek_chunk = 0;
+        uint64_t seek_s0 = s0, seek_s1 = s1, seek_s2 = s2;
+
+        alignas(64) uint32_t live[6][Kernel::lanes];
+        alignas(64) uint32_t digest[4][Kernel::lanes];
+
+        for (;;) {
+            uint64_t chunk = next_chunk.fetch_add(1, std::memory_order_relaxed);
+            uint64_t current_n_base = chunk * CHUNK_SIZE + 1;
+            if (current_n_base >= min_found_n.load(std::memory_order_relaxed)) break;
+            const uint64_t gap = (chunk - seek_chunk) * CHUNK_SIZE;
+            seek_s0 = g_jump_table.advance(seek_s0, gap);
+            seek_s1 = g_jump_table.advance(seek_s1, gap);
+            seek_s2 = g_jump_table.advance(seek_s2, gap);
+            seek_chunk = chunk;
+            uint64_t b0 = seek_s0, b1 = seek_s1, b2 = seek_s2;
+            const uint64_t chunk_end = current_n_base + CHUNK_SIZE;
+
+            while (current_n_base < chunk_end && current_n_base < min_found_n.load(std::memory_order_relaxed)) {
+                fallback_live_words<Kernel>(b0, b1, b2, live);
+                Kernel::hash(live, digest);
+                for (int l = 0; l < Kernel::lanes; ++l) {
+                    if (digest[0][l] == target[0] && digest[1][l] == target[1] && digest[2][l] == target[2] && digest[3][l] == target[3]) {
+                        uint64_t found_n = current_n_base + l;
+                        uint64_t prev_min = min_found_n.load(std::memory_order_relaxed);
+                        while (found_n < prev_min) { if (min_found_n.compare_exchange_weak(prev_min, found_n)) break; }
+                        break;
+                    }
+                }
+                current_n_base += Kernel::lanes;
+                hashed += Kernel::lanes;
+            }
+        }
+        record_thread_rate(hashed, t0);
+    }
+    return min_found_n.load();
+}
+
+// Reads the five queries from stdin and prints each answer.
+template <class Search>
+int solve_stdin(Search search) {
     for (int i = 0; i < 5; ++i) {
         std::string s0_hex, s1_hex, s2_hex;
         std::cin >> s0_hex >> s1_hex >> s2_hex;
@@ -166,173 +478,1150 @@ int main() {
         std::cin >> target_hash_hex;
         alignas(32) unsigned char target_hash_bytes[16];
         hex_to_bytes(target_hash_hex, target_hash_bytes);
-        uint32_t target_hash_u32[4];
-        memcpy(target_hash_u32, target_hash_bytes, 16);
+        std::cout << search(s0, s1, s2, target_hash_bytes) << std::endl;
+        if (g_thread_stats) print_thread_rates(i);
+    }
+    return 0;
+}
 
-        constants.target_A = _mm512_set1_epi32(target_hash_u32[0]); constants.target_B = _mm512_set1_epi32(target_hash_u32[1]);
-        constants.target_C = _mm512_set1_epi32(target_hash_u32[2]); constants.target_D = _mm512_set1_epi32(target_hash_u32[3]);
+#pragma GCC push_options
+#pragma GCC target("avx2")
+// AVX2 operations for Md5Steps.
+struct Ymm {
+    using type = __m256i;
+    static inline __m256i f(__m256i x, __m256i y, __m256i z) { return _mm256_or_si256(_mm256_and_si256(x, y), _mm256_andnot_si256(x, z)); }
+    static inline __m256i g(__m256i x, __m256i y, __m256i z) { return _mm256_or_si256(_mm256_and_si256(z, x), _mm256_andnot_si256(z, y)); }
+    static inline __m256i h(__m256i x, __m256i y, __m256i z) { return _mm256_xor_si256(x, _mm256_xor_si256(y, z)); }
+    static inline __m256i i(__m256i x, __m256i y, __m256i z) { return _mm256_xor_si256(y, _mm256_or_si256(x, _mm256_xor_si256(z, _mm256_set1_epi32(-1)))); }
+    static inline __m256i add(__m256i x, __m256i y) { return _mm256_add_epi32(x, y); }
+    template <int S> static inline __m256i rotl(__m256i x) { return _mm256_or_si256(_mm256_slli_epi32(x, S), _mm256_srli_epi32(x, 32 - S)); }
+};
 
-        std::atomic<uint64_t> min_found_n(ULLONG_MAX);
-        XorshiftJump::matrix single_step_mat = XorshiftJump::get_xorshift_matrix();
-        XorshiftJump::matrix stride_jump_mat;
+void Md5Avx2Kernel::hash(const uint32_t live[6][lanes], uint32_t digest[4][lanes]) {
+    constexpr int GROUPS = lanes / 8;
+    using Steps = Md5Steps<Ymm, GROUPS>;
+    __m256i s[4][GROUPS];
+    Steps::each_chain([&](int g) {
+        s[0][g] = _mm256_set1_epi32(MD5_INIT[0]); s[1][g] = _mm256_set1_epi32(MD5_INIT[1]);
+        s[2][g] = _mm256_set1_epi32(MD5_INIT[2]); s[3][g] = _mm256_set1_epi32(MD5_INIT[3]);
+    });
+    auto word = [&](auto w, int g) {
+        constexpr int row = md5_live_row(decltype(w)::value);
+        if constexpr (row >= 0) return _mm256_load_si256((const __m256i*)&live[row][8 * g]);
+        else return Md5Zero{};
+    };
+    auto konst = [](auto i) {
+        constexpr int step = decltype(i)::value;
+        return _mm256_set1_epi32(MD5_K[step] + md5_fixed_word(md5_word(step)));
+    };
+    Steps::run(s, word, konst);
+    Steps::each_chain([&](int g) {
+        _mm256_store_si256((__m256i*)&digest[0][8 * g], _mm256_add_epi32(s[0][g], _mm256_set1_epi32(MD5_INIT[0])));
+        _mm256_store_si256((__m256i*)&digest[1][8 * g], _mm256_add_epi32(s[1][g], _mm256_set1_epi32(MD5_INIT[1])));
+        _mm256_store_si256((__m256i*)&digest[2][8 * g], _mm256_add_epi32(s[2][g], _mm256_set1_epi32(MD5_INIT[2])));
+        _mm256_store_si256((__m256i*)&digest[3][8 * g], _mm256_add_epi32(s[3][g], _mm256_set1_epi32(MD5_INIT[3])));
+    });
+}
+#pragma GCC pop_options
 
-        #pragma omp parallel
-        {
-            #pragma omp single
-            {
-                int num_threads = omp_get_num_threads();
-                stride_jump_mat = XorshiftJump::power(single_step_mat, (uint64_t)num_threads * SIMD_WIDTH * 4);
-                precompute_jump_luts(stride_jump_mat);
+// Everything below up to main works on __m512i and is compiled for AVX-512 whatever
+// -march the file is built with; main only enters it on a CPU that has it.
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx512dq,avx512bw,avx512vl")
+
+// MD5 boolean functions. The TERNLOG forms map each one to a single vpternlogd;
+// kernels pick a form through Zmm<TERNLOG>.
+template <bool TERNLOG> struct MD5Bool {
+    static inline __m512i f(__m512i x, __m512i y, __m512i z) {
+        if constexpr (TERNLOG) return _mm512_ternarylogic_epi32(x, y, z, 0xCA);
+        else return _mm512_or_si512(_mm512_and_si512(x, y), _mm512_andnot_si512(x, z));
+    }
+    static inline __m512i g(__m512i x, __m512i y, __m512i z) {
+        if constexpr (TERNLOG) return _mm512_ternarylogic_epi32(x, y, z, 0xE4);
+        else return _mm512_or_si512(_mm512_and_si512(x, z), _mm512_andnot_si512(z, y));
+    }
+    static inline __m512i h(__m512i x, __m512i y, __m512i z) {
+        if constexpr (TERNLOG) return _mm512_ternarylogic_epi32(x, y, z, 0x96);
+        else return _mm512_xor_si512(x, _mm512_xor_si512(y, z));
+    }
+    static inline __m512i i(__m512i x, __m512i y, __m512i z) {
+        if constexpr (TERNLOG) return _mm512_ternarylogic_epi32(x, y, z, 0x39);
+        else return _mm512_xor_si512(y, _mm512_or_si512(x, _mm512_xor_si512(z, _mm512_set1_epi32(0xFFFFFFFF))));
+    }
+};
+
+// AVX-512 operations for Md5Steps.
+template <bool TERNLOG> struct Zmm : MD5Bool<TERNLOG> {
+    using type = __m512i;
+    static inline __m512i add(__m512i x, __m512i y) { return _mm512_add_epi32(x, y); }
+    template <int S> static inline __m512i rotl(__m512i x) { return ROTATE_LEFT(x, S); }
+};
+
+// --- Interleave-templated kernel ---
+// GROUPS independent 16-lane chains run through every step together, and the step
+// loops are fully unrolled at compile time. Force-inlined: expanded, the kernel is too
+// big for the inliner to pull into the search loop on its own.
+
+template <int GROUPS, bool TERNLOG>
+inline __attribute__((always_inline)) void md5_groups_48_byte(const uint32_t live[GROUPS][6][SIMD_WIDTH], __m512i digest[GROUPS][4]) {
+    using Steps = Md5Steps<Zmm<TERNLOG>, GROUPS>;
+    __m512i s[4][GROUPS];
+    Steps::each_chain([&](int g) {
+        s[0][g] = _mm512_set1_epi32(MD5_INIT[0]); s[1][g] = _mm512_set1_epi32(MD5_INIT[1]);
+        s[2][g] = _mm512_set1_epi32(MD5_INIT[2]); s[3][g] = _mm512_set1_epi32(MD5_INIT[3]);
+    });
+    // Live words are read where a step uses them, so they can be folded into the add
+    // rather than pinned in registers; the constant words are folded into konst.
+    auto word = [&](auto w, int g) {
+        constexpr int row = md5_live_row(decltype(w)::value);
+        if constexpr (row >= 0) return _mm512_load_si512((const __m512i*)live[g][row]);
+        else return Md5Zero{};
+    };
+    auto konst = [](auto i) {
+        constexpr int step = decltype(i)::value;
+        return _mm512_set1_epi32(MD5_K[step] + md5_fixed_word(md5_word(step)));
+    };
+    Steps::run(s, word, konst);
+    Steps::each_chain([&](int g) {
+        digest[g][0] = _mm512_add_epi32(s[0][g], _mm512_set1_epi32(MD5_INIT[0]));
+        digest[g][1] = _mm512_add_epi32(s[1][g], _mm512_set1_epi32(MD5_INIT[1]));
+        digest[g][2] = _mm512_add_epi32(s[2][g], _mm512_set1_epi32(MD5_INIT[2]));
+        digest[g][3] = _mm512_add_epi32(s[3][g], _mm512_set1_epi32(MD5_INIT[3]));
+    });
+}
+
+// Writes the live words of GROUPS * 16 consecutive candidates, advancing the streams.
+template <int GROUPS>
+inline void generate_live_words(uint64_t& s0, uint64_t& s1, uint64_t& s2, uint32_t live[GROUPS][6][SIMD_WIDTH]) {
+    alignas(64) uint64_t s_nums[3][GROUPS * SIMD_WIDTH];
+    for (int i = 0; i < GROUPS * SIMD_WIDTH; ++i) {
+        xorshift64(s0); s_nums[0][i] = s0;
+        xorshift64(s1); s_nums[1][i] = s1;
+        xorshift64(s2); s_nums[2][i] = s2;
+    }
+    for (int stream = 0; stream < 3; ++stream) {
+        for (int g = 0; g < GROUPS; ++g) {
+            __m512i vec1 = _mm512_load_si512(&s_nums[stream][g * 16]);
+            __m512i vec2 = _mm512_load_si512(&s_nums[stream][g * 16 + 8]);
+            __m512i lo = _mm512_inserti64x4(_mm512_castsi256_si512(_mm512_cvtepi64_epi32(vec1)), _mm512_cvtepi64_epi32(vec2), 1);
+            __m512i hi = _mm512_inserti64x4(_mm512_castsi256_si512(_mm512_cvtepi64_epi32(_mm512_srli_epi64(vec1, 32))),
+                                            _mm512_cvtepi64_epi32(_mm512_srli_epi64(vec2, 32)), 1);
+            _mm512_store_si512((__m512i*)live[g][2 * stream], lo);
+            _mm512_store_si512((__m512i*)live[g][2 * stream + 1], hi);
+        }
+    }
+}
+
+// --- Generic candidate-hashing engine ---
+// Hashes 16 candidates per call for any message layout with MD5, SHA-1 or SHA-256,
+// including multi-block messages. md5_groups_48_byte stays the fast path for the
+// scored 48-byte MD5 layout.
+namespace HashEngine {
+    // A LEN-byte message where stream k's 64-bit value is stored little-endian at
+    // 32-bit word STREAM_WORDS[k]. All other message bytes are zero.
+    template <size_t LEN, size_t... STREAM_WORDS>
+    struct Layout {
+        static constexpr size_t len = LEN;
+        static constexpr size_t num_streams = sizeof...(STREAM_WORDS);
+        static constexpr size_t num_blocks = (LEN + 8) / 64 + 1;
+        static constexpr size_t stream_words[num_streams] = {STREAM_WORDS...};
+        static constexpr size_t first_live_word = std::min({STREAM_WORDS...});
+        // Everything before first_live_word is fixed: the blocks before first_live_block,
+        // and the first prefix_steps steps of that block, which only read words < 16.
+        static constexpr size_t first_live_block = first_live_word / 16;
+        static constexpr int prefix_steps = first_live_word % 16;
+
+        // 2*k for the low word of stream k, 2*k+1 for its high word, -1 for a fixed word.
+        static constexpr int source(size_t word) {
+            for (size_t k = 0; k < num_streams; ++k) {
+                if (word == stream_words[k]) return 2 * k;
+                if (word == stream_words[k] + 1) return 2 * k + 1;
             }
+            return -1;
+        }
+        // Fixed words carry only the 0x80 terminator and the bit length.
+        static constexpr uint32_t fixed_word(size_t word, bool big_endian) {
+            uint32_t w = 0;
+            for (size_t i = 0; i < 4; ++i) {
+                size_t pos = word * 4 + i;
+                uint32_t byte = 0;
+                size_t len_pos = num_blocks * 64 - 8;
+                if (pos == LEN) byte = 0x80;
+                else if (pos >= len_pos) {
+                    size_t shift = big_endian ? (7 - (pos - len_pos)) * 8 : (pos - len_pos) * 8;
+                    byte = shift < 64 ? (uint32_t)(((uint64_t)LEN * 8) >> shift) & 0xFF : 0;
+                }
+                w |= big_endian ? byte << (24 - 8 * i) : byte << (8 * i);
+            }
+            return w;
+        }
+    };
+
+    // Each hash runs steps [FIRST, LAST) of one block on the working state v, which
+    // starts as the chaining value; see compress_from.
+    struct MD5 {
+        static constexpr int state_words = 4;
+        static constexpr int rounds = 64;
+        static constexpr bool big_endian = false;
+        static void init(__m512i st[4]) {
+            st[0] = _mm512_set1_epi32(0x67452301); st[1] = _mm512_set1_epi32(0xefcdab89);
+            st[2] = _mm512_set1_epi32(0x98badcfe); st[3] = _mm512_set1_epi32(0x10325476);
+        }
+        // Force-inlined: expanded, the steps are too big for the inliner to pull into
+        // the search loop on its own.
+        template <int FIRST, int LAST>
+        static inline __attribute__((always_inline)) void steps(__m512i v[4], __m512i w[16]) {
+            using Steps = Md5Steps<Zmm<false>, 1>;
+            __m512i s[4][1];
+            for (int k = 0; k < 4; ++k) s[Steps::reg(FIRST, k)][0] = v[k];
+            Steps::run<FIRST, LAST>(s, [&](auto word, int) { return w[decltype(word)::value]; },
+                                    [](auto i) { return _mm512_set1_epi32(MD5_K[decltype(i)::value]); });
+            for (int k = 0; k < 4; ++k) v[k] = s[Steps::reg(LAST, k)][0];
+        }
+    };
 
-            int thread_id = omp_get_thread_num();
-            XorshiftJump::matrix start_jump_mat = XorshiftJump::power(single_step_mat, (uint64_t)thread_id * SIMD_WIDTH * 4);
-            uint64_t s0_block_start = XorshiftJump::transform(start_jump_mat, s0);
-            uint64_t s1_block_start = XorshiftJump::transform(start_jump_mat, s1);
-            uint64_t s2_block_start = XorshiftJump::transform(start_jump_mat, s2);
-            
-            uint64_t current_n_base = (uint64_t)thread_id * SIMD_WIDTH * 4 + 1;
-
-            alignas(64) uint32_t soa_input_buffer0[12][SIMD_WIDTH], soa_input_buffer1[12][SIMD_WIDTH];
-            alignas(64) uint32_t soa_input_buffer2[12][SIMD_WIDTH], soa_input_buffer3[12][SIMD_WIDTH];
-            
-            while (current_n_base < min_found_n.load(std::memory_order_relaxed)) {
-                memset(soa_input_buffer0, 0, sizeof(soa_input_buffer0));
-                memset(soa_input_buffer1, 0, sizeof(soa_input_buffer1));
-                memset(soa_input_buffer2, 0, sizeof(soa_input_buffer2));
-                memset(soa_input_buffer3, 0, sizeof(soa_input_buffer3));
-
-                generate_scalar_and_store_vectorized(
-                    s0_block_start, s1_block_start, s2_block_start,
-                    soa_input_buffer0, soa_input_buffer1,
-                    soa_input_buffer2, soa_input_buffer3);
-                
-                __m512i a0=constants.A_init, b0=constants.B_init, c0=constants.C_init, d0=constants.D_init;
-                __m512i a1=constants.A_init, b1=constants.B_init, c1=constants.C_init, d1=constants.D_init;
-                __m512i a2=constants.A_init, b2=constants.B_init, c2=constants.C_init, d2=constants.D_init;
-                __m512i a3=constants.A_init, b3=constants.B_init, c3=constants.C_init, d3=constants.D_init;
-                __m512i A0=a0, B0=b0, C0=c0, D0=d0;
-                __m512i A1=a1, B1=b1, C1=c1, D1=d1;
-                __m512i A2=a2, B2=b2, C2=c2, D2=d2;
-                __m512i A3=a3, B3=b3, C3=c3, D3=d3;
-
-                #define LOAD0(i) _mm512_load_si512((const __m512i*)soa_input_buffer0[i])
-                #define LOAD1(i) _mm512_load_si512((const __m512i*)soa_input_buffer1[i])
-                #define LOAD2(i) _mm512_load_si512((const __m512i*)soa_input_buffer2[i])
-                #define LOAD3(i) _mm512_load_si512((const __m512i*)soa_input_buffer3[i])
-                
-                FF(a0,b0,c0,d0,LOAD0(0), 7,constants.K[0]);  FF(a1,b1,c1,d1,LOAD1(0), 7,constants.K[0]);  FF(a2,b2,c2,d2,LOAD2(0), 7,constants.K[0]);  FF(a3,b3,c3,d3,LOAD3(0), 7,constants.K[0]);
-                FF(d0,a0,b0,c0,LOAD0(1), 12,constants.K[1]); FF(d1,a1,b1,c1,LOAD1(1), 12,constants.K[1]); FF(d2,a2,b2,c2,LOAD2(1), 12,constants.K[1]); FF(d3,a3,b3,c3,LOAD3(1), 12,constants.K[1]);
-                FF(c0,d0,a0,b0,LOAD0(2), 17,constants.K[2]); FF(c1,d1,a1,b1,LOAD1(2), 17,constants.K[2]); FF(c2,d2,a2,b2,LOAD2(2), 17,constants.K[2]); FF(c3,d3,a3,b3,LOAD3(2), 17,constants.K[2]);
-                FF(b0,c0,d0,a0,LOAD0(3), 22,constants.K[3]); FF(b1,c1,d1,a1,LOAD1(3), 22,constants.K[3]); FF(b2,c2,d2,a2,LOAD2(3), 22,constants.K[3]); FF(b3,c3,d3,a3,LOAD3(3), 22,constants.K[3]);
-                FF(a0,b0,c0,d0,LOAD0(4), 7,constants.K[4]);  FF(a1,b1,c1,d1,LOAD1(4), 7,constants.K[4]);  FF(a2,b2,c2,d2,LOAD2(4), 7,constants.K[4]);  FF(a3,b3,c3,d3,LOAD3(4), 7,constants.K[4]);
-                FF(d0,a0,b0,c0,LOAD0(5), 12,constants.K[5]); FF(d1,a1,b1,c1,LOAD1(5), 12,constants.K[5]); FF(d2,a2,b2,c2,LOAD2(5), 12,constants.K[5]); FF(d3,a3,b3,c3,LOAD3(5), 12,constants.K[5]);
-                FF(c0,d0,a0,b0,LOAD0(6), 17,constants.K[6]); FF(c1,d1,a1,b1,LOAD1(6), 17,constants.K[6]); FF(c2,d2,a2,b2,LOAD2(6), 17,constants.K[6]); FF(c3,d3,a3,b3,LOAD3(6), 17,constants.K[6]);
-                FF(b0,c0,d0,a0,LOAD0(7), 22,constants.K[7]); FF(b1,c1,d1,a1,LOAD1(7), 22,constants.K[7]); FF(b2,c2,d2,a2,LOAD2(7), 22,constants.K[7]); FF(b3,c3,d3,a3,LOAD3(7), 22,constants.K[7]);
-                FF(a0,b0,c0,d0,LOAD0(8), 7,constants.K[8]);  FF(a1,b1,c1,d1,LOAD1(8), 7,constants.K[8]);  FF(a2,b2,c2,d2,LOAD2(8), 7,constants.K[8]);  FF(a3,b3,c3,d3,LOAD3(8), 7,constants.K[8]);
-                FF(d0,a0,b0,c0,LOAD0(9), 12,constants.K[9]); FF(d1,a1,b1,c1,LOAD1(9), 12,constants.K[9]); FF(d2,a2,b2,c2,LOAD2(9), 12,constants.K[9]); FF(d3,a3,b3,c3,LOAD3(9), 12,constants.K[9]);
-                FF(c0,d0,a0,b0,LOAD0(10),17,constants.K[10]);FF(c1,d1,a1,b1,LOAD1(10),17,constants.K[10]);FF(c2,d2,a2,b2,LOAD2(10),17,constants.K[10]);FF(c3,d3,a3,b3,LOAD3(10),17,constants.K[10]);
-                FF(b0,c0,d0,a0,LOAD0(11),22,constants.K[11]);FF(b1,c1,d1,a1,LOAD1(11),22,constants.K[11]);FF(b2,c2,d2,a2,LOAD2(11),22,constants.K[11]);FF(b3,c3,d3,a3,LOAD3(11),22,constants.K[11]);
-                FF(a0,b0,c0,d0,constants.X12,7,constants.K[12]); FF(a1,b1,c1,d1,constants.X12,7,constants.K[12]); FF(a2,b2,c2,d2,constants.X12,7,constants.K[12]); FF(a3,b3,c3,d3,constants.X12,7,constants.K[12]);
-                FF(d0,a0,b0,c0,constants.X13,12,constants.K[13]);FF(d1,a1,b1,c1,constants.X13,12,constants.K[13]);FF(d2,a2,b2,c2,constants.X13,12,constants.K[13]);FF(d3,a3,b3,c3,constants.X13,12,constants.K[13]);
-                FF(c0,d0,a0,b0,constants.X14,17,constants.K[14]);FF(c1,d1,a1,b1,constants.X14,17,constants.K[14]);FF(c2,d2,a2,b2,constants.X14,17,constants.K[14]);FF(c3,d3,a3,b3,constants.X14,17,constants.K[14]);
-                FF(b0,c0,d0,a0,constants.X15,22,constants.K[15]);FF(b1,c1,d1,a1,constants.X15,22,constants.K[15]);FF(b2,c2,d2,a2,constants.X15,22,constants.K[15]);FF(b3,c3,d3,a3,constants.X15,22,constants.K[15]);
-                GG(a0,b0,c0,d0,LOAD0(1), 5,constants.K[16]);  GG(a1,b1,c1,d1,LOAD1(1), 5,constants.K[16]);  GG(a2,b2,c2,d2,LOAD2(1), 5,constants.K[16]);  GG(a3,b3,c3,d3,LOAD3(1), 5,constants.K[16]);
-                GG(d0,a0,b0,c0,LOAD0(6), 9,constants.K[17]);  GG(d1,a1,b1,c1,LOAD1(6), 9,constants.K[17]);  GG(d2,a2,b2,c2,LOAD2(6), 9,constants.K[17]);  GG(d3,a3,b3,c3,LOAD3(6), 9,constants.K[17]);
-                GG(c0,d0,a0,b0,LOAD0(11),14,constants.K[18]); GG(c1,d1,a1,b1,LOAD1(11),14,constants.K[18]); GG(c2,d2,a2,b2,LOAD2(11),14,constants.K[18]); GG(c3,d3,a3,b3,LOAD3(11),14,constants.K[18]);
-                GG(b0,c0,d0,a0,LOAD0(0), 20,constants.K[19]);  GG(b1,c1,d1,a1,LOAD1(0), 20,constants.K[19]);  GG(b2,c2,d2,a2,LOAD2(0), 20,constants.K[19]);  GG(b3,c3,d3,a3,LOAD3(0), 20,constants.K[19]);
-                GG(a0,b0,c0,d0,LOAD0(5), 5,constants.K[20]);  GG(a1,b1,c1,d1,LOAD1(5), 5,constants.K[20]);  GG(a2,b2,c2,d2,LOAD2(5), 5,constants.K[20]);  GG(a3,b3,c3,d3,LOAD3(5), 5,constants.K[20]);
-                GG(d0,a0,b0,c0,LOAD0(10),9,constants.K[21]);  GG(d1,a1,b1,c1,LOAD1(10),9,constants.K[21]);  GG(d2,a2,b2,c2,LOAD2(10),9,constants.K[21]);  GG(d3,a3,b3,c3,LOAD3(10),9,constants.K[21]);
-                GG(c0,d0,a0,b0,constants.X15,14,constants.K[22]);GG(c1,d1,a1,b1,constants.X15,14,constants.K[22]);GG(c2,d2,a2,b2,constants.X15,14,constants.K[22]);GG(c3,d3,a3,b3,constants.X15,14,constants.K[22]);
-                GG(b0,c0,d0,a0,LOAD0(4), 20,constants.K[23]);  GG(b1,c1,d1,a1,LOAD1(4), 20,constants.K[23]);  GG(b2,c2,d2,a2,LOAD2(4), 20,constants.K[23]);  GG(b3,c3,d3,a3,LOAD3(4), 20,constants.K[23]);
-                GG(a0,b0,c0,d0,LOAD0(9), 5,constants.K[24]);  GG(a1,b1,c1,d1,LOAD1(9), 5,constants.K[24]);  GG(a2,b2,c2,d2,LOAD2(9), 5,constants.K[24]);  GG(a3,b3,c3,d3,LOAD3(9), 5,constants.K[24]);
-                GG(d0,a0,b0,c0,constants.X14,9,constants.K[25]); GG(d1,a1,b1,c1,constants.X14,9,constants.K[25]); GG(d2,a2,b2,c2,constants.X14,9,constants.K[25]); GG(d3,a3,b3,c3,constants.X14,9,constants.K[25]);
-                GG(c0,d0,a0,b0,LOAD0(3), 14,constants.K[26]);  GG(c1,d1,a1,b1,LOAD1(3), 14,constants.K[26]);  GG(c2,d2,a2,b2,LOAD2(3), 14,constants.K[26]);  GG(c3,d3,a3,b3,LOAD3(3), 14,constants.K[26]);
-                GG(b0,c0,d0,a0,LOAD0(8), 20,constants.K[27]);  GG(b1,c1,d1,a1,LOAD1(8), 20,constants.K[27]);  GG(b2,c2,d2,a2,LOAD2(8), 20,constants.K[27]);  GG(b3,c3,d3,a3,LOAD3(8), 20,constants.K[27]);
-                GG(a0,b0,c0,d0,constants.X13,5,constants.K[28]); GG(a1,b1,c1,d1,constants.X13,5,constants.K[28]); GG(a2,b2,c2,d2,constants.X13,5,constants.K[28]); GG(a3,b3,c3,d3,constants.X13,5,constants.K[28]);
-                GG(d0,a0,b0,c0,LOAD0(2), 9,constants.K[29]);  GG(d1,a1,b1,c1,LOAD1(2), 9,constants.K[29]);  GG(d2,a2,b2,c2,LOAD2(2), 9,constants.K[29]);  GG(d3,a3,b3,c3,LOAD3(2), 9,constants.K[29]);
-                GG(c0,d0,a0,b0,LOAD0(7), 14,constants.K[30]);  GG(c1,d1,a1,b1,LOAD1(7), 14,constants.K[30]);  GG(c2,d2,a2,b2,LOAD2(7), 14,constants.K[30]);  GG(c3,d3,a3,b3,LOAD3(7), 14,constants.K[30]);
-                GG(b0,c0,d0,a0,constants.X12,20,constants.K[31]);GG(b1,c1,d1,a1,constants.X12,20,constants.K[31]);GG(b2,c2,d2,a2,constants.X12,20,constants.K[31]);GG(b3,c3,d3,a3,constants.X12,20,constants.K[31]);
-                HH(a0,b0,c0,d0,LOAD0(5), 4,constants.K[32]);  HH(a1,b1,c1,d1,LOAD1(5), 4,constants.K[32]);  HH(a2,b2,c2,d2,LOAD2(5), 4,constants.K[32]);  HH(a3,b3,c3,d3,LOAD3(5), 4,constants.K[32]);
-                HH(d0,a0,b0,c0,LOAD0(8), 11,constants.K[33]);  HH(d1,a1,b1,c1,LOAD1(8), 11,constants.K[33]);  HH(d2,a2,b2,c2,LOAD2(8), 11,constants.K[33]);  HH(d3,a3,b3,c3,LOAD3(8), 11,constants.K[33]);
-                HH(c0,d0,a0,b0,LOAD0(11),16,constants.K[34]);  HH(c1,d1,a1,b1,LOAD1(11),16,constants.K[34]);  HH(c2,d2,a2,b2,LOAD2(11),16,constants.K[34]);  HH(c3,d3,a3,b3,LOAD3(11),16,constants.K[34]);
-                HH(b0,c0,d0,a0,constants.X14,23,constants.K[35]);HH(b1,c1,d1,a1,constants.X14,23,constants.K[35]);HH(b2,c2,d2,a2,constants.X14,23,constants.K[35]);HH(b3,c3,d3,a3,constants.X14,23,constants.K[35]);
-                HH(a0,b0,c0,d0,LOAD0(1), 4,constants.K[36]);  HH(a1,b1,c1,d1,LOAD1(1), 4,constants.K[36]);  HH(a2,b2,c2,d2,LOAD2(1), 4,constants.K[36]);  HH(a3,b3,c3,d3,LOAD3(1), 4,constants.K[36]);
-                HH(d0,a0,b0,c0,LOAD0(4), 11,constants.K[37]);  HH(d1,a1,b1,c1,LOAD1(4), 11,constants.K[37]);  HH(d2,a2,b2,c2,LOAD2(4), 11,constants.K[37]);  HH(d3,a3,b3,c3,LOAD3(4), 11,constants.K[37]);
-                HH(c0,d0,a0,b0,LOAD0(7), 16,constants.K[38]);  HH(c1,d1,a1,b1,LOAD1(7), 16,constants.K[38]);  HH(c2,d2,a2,b2,LOAD2(7), 16,constants.K[38]);  HH(c3,d3,a3,b3,LOAD3(7), 16,constants.K[38]);
-                HH(b0,c0,d0,a0,LOAD0(10),23,constants.K[39]);  HH(b1,c1,d1,a1,LOAD1(10),23,constants.K[39]);  HH(b2,c2,d2,a2,LOAD2(10),23,constants.K[39]);  HH(b3,c3,d3,a3,LOAD3(10),23,constants.K[39]);
-                HH(a0,b0,c0,d0,constants.X13,4,constants.K[40]); HH(a1,b1,c1,d1,constants.X13,4,constants.K[40]); HH(a2,b2,c2,d2,constants.X13,4,constants.K[40]); HH(a3,b3,c3,d3,constants.X13,4,constants.K[40]);
-                HH(d0,a0,b0,c0,LOAD0(0), 11,constants.K[41]);  HH(d1,a1,b1,c1,LOAD1(0), 11,constants.K[41]);  HH(d2,a2,b2,c2,LOAD2(0), 11,constants.K[41]);  HH(d3,a3,b3,c3,LOAD3(0), 11,constants.K[41]);
-                HH(c0,d0,a0,b0,LOAD0(3), 16,constants.K[42]);  HH(c1,d1,a1,b1,LOAD1(3), 16,constants.K[42]);  HH(c2,d2,a2,b2,LOAD2(3), 16,constants.K[42]);  HH(c3,d3,a3,b3,LOAD3(3), 16,constants.K[42]);
-                HH(b0,c0,d0,a0,LOAD0(6), 23,constants.K[43]);  HH(b1,c1,d1,a1,LOAD1(6), 23,constants.K[43]);  HH(b2,c2,d2,a2,LOAD2(6), 23,constants.K[43]);  HH(b3,c3,d3,a3,LOAD3(6), 23,constants.K[43]);
-                HH(a0,b0,c0,d0,LOAD0(9), 4,constants.K[44]);  HH(a1,b1,c1,d1,LOAD1(9), 4,constants.K[44]);  HH(a2,b2,c2,d2,LOAD2(9), 4,constants.K[44]);  HH(a3,b3,c3,d3,LOAD3(9), 4,constants.K[44]);
-                HH(d0,a0,b0,c0,constants.X12,11,constants.K[45]);HH(d1,a1,b1,c1,constants.X12,11,constants.K[45]);HH(d2,a2,b2,c2,constants.X12,11,constants.K[45]);HH(d3,a3,b3,c3,constants.X12,11,constants.K[45]);
-                HH(c0,d0,a0,b0,constants.X15,16,constants.K[46]);HH(c1,d1,a1,b1,constants.X15,16,constants.K[46]);HH(c2,d2,a2,b2,constants.X15,16,constants.K[46]);HH(c3,d3,a3,b3,constants.X15,16,constants.K[46]);
-                HH(b0,c0,d0,a0,LOAD0(2), 23,constants.K[47]);  HH(b1,c1,d1,a1,LOAD1(2), 23,constants.K[47]);  HH(b2,c2,d2,a2,LOAD2(2), 23,constants.K[47]);  HH(b3,c3,d3,a3,LOAD3(2), 23,constants.K[47]);
-                II(a0,b0,c0,d0,LOAD0(0), 6,constants.K[48]);  II(a1,b1,c1,d1,LOAD1(0), 6,constants.K[48]);  II(a2,b2,c2,d2,LOAD2(0), 6,constants.K[48]);  II(a3,b3,c3,d3,LOAD3(0), 6,constants.K[48]);
-                II(d0,a0,b0,c0,LOAD0(7), 10,constants.K[49]);  II(d1,a1,b1,c1,LOAD1(7), 10,constants.K[49]);  II(d2,a2,b2,c2,LOAD2(7), 10,constants.K[49]);  II(d3,a3,b3,c3,LOAD3(7), 10,constants.K[49]);
-                II(c0,d0,a0,b0,constants.X14,15,constants.K[50]);II(c1,d1,a1,b1,constants.X14,15,constants.K[50]);II(c2,d2,a2,b2,constants.X14,15,constants.K[50]);II(c3,d3,a3,b3,constants.X14,15,constants.K[50]);
-                II(b0,c0,d0,a0,LOAD0(5), 21,constants.K[51]);  II(b1,c1,d1,a1,LOAD1(5), 21,constants.K[51]);  II(b2,c2,d2,a2,LOAD2(5), 21,constants.K[51]);  II(b3,c3,d3,a3,LOAD3(5), 21,constants.K[51]);
-                II(a0,b0,c0,d0,constants.X12,6,constants.K[52]); II(a1,b1,c1,d1,constants.X12,6,constants.K[52]); II(a2,b2,c2,d2,constants.X12,6,constants.K[52]); II(a3,b3,c3,d3,constants.X12,6,constants.K[52]);
-                II(d0,a0,b0,c0,LOAD0(3), 10,constants.K[53]);  II(d1,a1,b1,c1,LOAD1(3), 10,constants.K[53]);  II(d2,a2,b2,c2,LOAD2(3), 10,constants.K[53]);  II(d3,a3,b3,c3,LOAD3(3), 10,constants.K[53]);
-                II(c0,d0,a0,b0,LOAD0(10),15,constants.K[54]);  II(c1,d1,a1,b1,LOAD1(10),15,constants.K[54]);  II(c2,d2,a2,b2,LOAD2(10),15,constants.K[54]);  II(c3,d3,a3,b3,LOAD3(10),15,constants.K[54]);
-                II(b0,c0,d0,a0,LOAD0(1), 21,constants.K[55]);  II(b1,c1,d1,a1,LOAD1(1), 21,constants.K[55]);  II(b2,c2,d2,a2,LOAD2(1), 21,constants.K[55]);  II(b3,c3,d3,a3,LOAD3(1), 21,constants.K[55]);
-                II(a0,b0,c0,d0,LOAD0(8), 6,constants.K[56]);  II(a1,b1,c1,d1,LOAD1(8), 6,constants.K[56]);  II(a2,b2,c2,d2,LOAD2(8), 6,constants.K[56]);  II(a3,b3,c3,d3,LOAD3(8), 6,constants.K[56]);
-                II(d0,a0,b0,c0,constants.X15,10,constants.K[57]);II(d1,a1,b1,c1,constants.X15,10,constants.K[57]);II(d2,a2,b2,c2,constants.X15,10,constants.K[57]);II(d3,a3,b3,c3,constants.X15,10,constants.K[57]);
-                II(c0,d0,a0,b0,LOAD0(6), 15,constants.K[58]);  II(c1,d1,a1,b1,LOAD1(6), 15,constants.K[58]);  II(c2,d2,a2,b2,LOAD2(6), 15,constants.K[58]);  II(c3,d3,a3,b3,LOAD3(6), 15,constants.K[58]);
-                II(b0,c0,d0,a0,constants.X13,21,constants.K[59]);II(b1,c1,d1,a1,constants.X13,21,constants.K[59]);II(b2,c2,d2,a2,constants.X13,21,constants.K[59]);II(b3,c3,d3,a3,constants.X13,21,constants.K[59]);
-                II(a0,b0,c0,d0,LOAD0(4), 6,constants.K[60]);  II(a1,b1,c1,d1,LOAD1(4), 6,constants.K[60]);  II(a2,b2,c2,d2,LOAD2(4), 6,constants.K[60]);  II(a3,b3,c3,d3,LOAD3(4), 6,constants.K[60]);
-                II(d0,a0,b0,c0,LOAD0(11),10,constants.K[61]);  II(d1,a1,b1,c1,LOAD1(11),10,constants.K[61]);  II(d2,a2,b2,c2,LOAD2(11),10,constants.K[61]);  II(d3,a3,b3,c3,LOAD3(11),10,constants.K[61]);
-                II(c0,d0,a0,b0,LOAD0(2), 15,constants.K[62]);  II(c1,d1,a1,b1,LOAD1(2), 15,constants.K[62]);  II(c2,d2,a2,b2,LOAD2(2), 15,constants.K[62]);  II(c3,d3,a3,b3,LOAD3(2), 15,constants.K[62]);
-                II(b0,c0,d0,a0,LOAD0(9), 21,constants.K[63]);  II(b1,c1,d1,a1,LOAD1(9), 21,constants.K[63]);  II(b2,c2,d2,a2,LOAD2(9), 21,constants.K[63]);  II(b3,c3,d3,a3,LOAD3(9), 21,constants.K[63]);
-                #undef LOAD0
-                #undef LOAD1
-                #undef LOAD2
-                #undef LOAD3
-
-                A0=_mm512_add_epi32(A0,a0); B0=_mm512_add_epi32(B0,b0); C0=_mm512_add_epi32(C0,c0); D0=_mm512_add_epi32(D0,d0);
-                A1=_mm512_add_epi32(A1,a1); B1=_mm512_add_epi32(B1,b1); C1=_mm512_add_epi32(C1,c1); D1=_mm512_add_epi32(D1,d1);
-                A2=_mm512_add_epi32(A2,a2); B2=_mm512_add_epi32(B2,b2); C2=_mm512_add_epi32(C2,c2); D2=_mm512_add_epi32(D2,d2);
-                A3=_mm512_add_epi32(A3,a3); B3=_mm512_add_epi32(B3,b3); C3=_mm512_add_epi32(C3,c3); D3=_mm512_add_epi32(D3,d3);
-
-                uint16_t match_mask;
-                match_mask = _mm512_cmpeq_epi32_mask(A0, constants.target_A) & _mm512_cmpeq_epi32_mask(B0, constants.target_B) & _mm512_cmpeq_epi32_mask(C0, constants.target_C) & _mm512_cmpeq_epi32_mask(D0, constants.target_D);
-                if (match_mask != 0) {
-                    int first_match_idx = __builtin_ctz(match_mask);
-                    uint64_t found_n = current_n_base + first_match_idx;
-                    uint64_t prev_min = min_found_n.load(std::memory_order_relaxed);
-                    while (found_n < prev_min) { if (min_found_n.compare_exchange_weak(prev_min, found_n)) break; }
+    struct SHA1 {
+        static constexpr int state_words = 5;
+        static constexpr int rounds = 80;
+        static constexpr bool big_endian = true;
+        static void init(__m512i st[5]) {
+            st[0] = _mm512_set1_epi32(0x67452301); st[1] = _mm512_set1_epi32(0xefcdab89);
+            st[2] = _mm512_set1_epi32(0x98badcfe); st[3] = _mm512_set1_epi32(0x10325476);
+            st[4] = _mm512_set1_epi32(0xc3d2e1f0);
+        }
+        template <int FIRST, int LAST>
+        static inline void steps(__m512i v[5], __m512i w[16]) {
+            __m512i a = v[0], b = v[1], c = v[2], d = v[3], e = v[4];
+            #pragma GCC unroll 80
+            for (int t = FIRST; t < LAST; ++t) {
+                if (t >= 16) {
+                    w[t & 15] = _mm512_rol_epi32(_mm512_xor_si512(_mm512_xor_si512(w[(t - 3) & 15], w[(t - 8) & 15]),
+                                                                  _mm512_xor_si512(w[(t - 14) & 15], w[t & 15])), 1);
                 }
-                match_mask = _mm512_cmpeq_epi32_mask(A1, constants.target_A) & _mm512_cmpeq_epi32_mask(B1, constants.target_B) & _mm512_cmpeq_epi32_mask(C1, constants.target_C) & _mm512_cmpeq_epi32_mask(D1, constants.target_D);
-                if (match_mask != 0) {
-                    int first_match_idx = __builtin_ctz(match_mask);
-                    uint64_t found_n = current_n_base + SIMD_WIDTH + first_match_idx;
-                    uint64_t prev_min = min_found_n.load(std::memory_order_relaxed);
-                    while (found_n < prev_min) { if (min_found_n.compare_exchange_weak(prev_min, found_n)) break; }
+                __m512i f;
+                uint32_t k;
+                if (t < 20)      { f = _mm512_ternarylogic_epi32(b, c, d, 0xCA); k = 0x5a827999; }
+                else if (t < 40) { f = _mm512_ternarylogic_epi32(b, c, d, 0x96); k = 0x6ed9eba1; }
+                else if (t < 60) { f = _mm512_ternarylogic_epi32(b, c, d, 0xE8); k = 0x8f1bbcdc; }
+                else             { f = _mm512_ternarylogic_epi32(b, c, d, 0x96); k = 0xca62c1d6; }
+                __m512i temp = _mm512_add_epi32(_mm512_add_epi32(_mm512_rol_epi32(a, 5), f),
+                                                _mm512_add_epi32(_mm512_add_epi32(e, _mm512_set1_epi32(k)), w[t & 15]));
+                e = d; d = c; c = _mm512_rol_epi32(b, 30); b = a; a = temp;
+            }
+            v[0] = a; v[1] = b; v[2] = c; v[3] = d; v[4] = e;
+        }
+    };
+
+    struct SHA256 {
+        static constexpr int state_words = 8;
+        static constexpr int rounds = 64;
+        static constexpr bool big_endian = true;
+        static void init(__m512i st[8]) {
+            static const uint32_t H0[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                           0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+            for (int i = 0; i < 8; ++i) st[i] = _mm512_set1_epi32(H0[i]);
+        }
+        template <int FIRST, int LAST>
+        static inline void steps(__m512i v[8], __m512i w[16]) {
+            static const uint32_t K[64] = {
+                0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+                0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+                0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+                0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+                0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+                0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+                0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+                0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+            };
+            __m512i a = v[0], b = v[1], c = v[2], d = v[3], e = v[4], f = v[5], g = v[6], h = v[7];
+            #pragma GCC unroll 64
+            for (int t = FIRST; t < LAST; ++t) {
+                if (t >= 16) {
+                    __m512i w15 = w[(t - 15) & 15], w2 = w[(t - 2) & 15];
+                    __m512i s0 = _mm512_ternarylogic_epi32(_mm512_ror_epi32(w15, 7), _mm512_ror_epi32(w15, 18), _mm512_srli_epi32(w15, 3), 0x96);
+                    __m512i s1 = _mm512_ternarylogic_epi32(_mm512_ror_epi32(w2, 17), _mm512_ror_epi32(w2, 19), _mm512_srli_epi32(w2, 10), 0x96);
+                    w[t & 15] = _mm512_add_epi32(_mm512_add_epi32(w[t & 15], s0), _mm512_add_epi32(w[(t - 7) & 15], s1));
                 }
-                match_mask = _mm512_cmpeq_epi32_mask(A2, constants.target_A) & _mm512_cmpeq_epi32_mask(B2, constants.target_B) & _mm512_cmpeq_epi32_mask(C2, constants.target_C) & _mm512_cmpeq_epi32_mask(D2, constants.target_D);
-                if (match_mask != 0) {
-                    int first_match_idx = __builtin_ctz(match_mask);
-                    uint64_t found_n = current_n_base + SIMD_WIDTH * 2 + first_match_idx;
-                    uint64_t prev_min = min_found_n.load(std::memory_order_relaxed);
-                    while (found_n < prev_min) { if (min_found_n.compare_exchange_weak(prev_min, found_n)) break; }
+                __m512i S1 = _mm512_ternarylogic_epi32(_mm512_ror_epi32(e, 6), _mm512_ror_epi32(e, 11), _mm512_ror_epi32(e, 25), 0x96);
+                __m512i ch = _mm512_ternarylogic_epi32(e, f, g, 0xCA);
+                __m512i t1 = _mm512_add_epi32(_mm512_add_epi32(h, S1), _mm512_add_epi32(ch, _mm512_add_epi32(_mm512_set1_epi32(K[t]), w[t & 15])));
+                __m512i S0 = _mm512_ternarylogic_epi32(_mm512_ror_epi32(a, 2), _mm512_ror_epi32(a, 13), _mm512_ror_epi32(a, 22), 0x96);
+                __m512i maj = _mm512_ternarylogic_epi32(a, b, c, 0xE8);
+                h = g; g = f; f = e; e = _mm512_add_epi32(d, t1);
+                d = c; c = b; b = a; a = _mm512_add_epi32(t1, _mm512_add_epi32(S0, maj));
+            }
+            v[0] = a; v[1] = b; v[2] = c; v[3] = d; v[4] = e; v[5] = f; v[6] = g; v[7] = h;
+        }
+    };
+
+    // Compresses block w into the chaining value st, resuming from the working state
+    // `work` reached after the first FIRST steps (work == st when FIRST is 0).
+    // Force-inlined like MD5::steps.
+    template <class Hash, int FIRST>
+    inline __attribute__((always_inline)) void compress_from(__m512i st[Hash::state_words], const __m512i work[Hash::state_words], __m512i w[16]) {
+        __m512i v[Hash::state_words];
+        for (int k = 0; k < Hash::state_words; ++k) v[k] = work[k];
+        Hash::template steps<FIRST, Hash::rounds>(v, w);
+        for (int k = 0; k < Hash::state_words; ++k) st[k] = _mm512_add_epi32(st[k], v[k]);
+    }
+
+    // words[2*k] / words[2*k+1] hold the low / high halves of stream k for 16 lanes.
+    template <class Hash, class L>
+    inline void load_block(size_t blk, const __m512i words[2 * L::num_streams], __m512i w[16]) {
+        const __m512i bswap = _mm512_set4_epi32(0x0c0d0e0f, 0x08090a0b, 0x04050607, 0x00010203);
+        for (size_t j = 0; j < 16; ++j) {
+            int src = L::source(blk * 16 + j);
+            if (src < 0) w[j] = _mm512_set1_epi32(L::fixed_word(blk * 16 + j, Hash::big_endian));
+            else w[j] = Hash::big_endian ? _mm512_shuffle_epi8(words[src], bswap) : words[src];
+        }
+    }
+
+    // Shared-prefix cache. Steps that only read fixed words leave every candidate in
+    // the same state, so for layouts whose streams sit behind fixed leading words
+    // (counter-style records) that state is computed once per search and broadcast.
+    template <class Hash, class L>
+    struct Midstate {
+        __m512i chain[Hash::state_words]; // chaining value entering L::first_live_block
+        __m512i work[Hash::state_words];  // working state after L::prefix_steps of its steps
+        __attribute__((always_inline)) Midstate() { // force-inlined like MD5::steps
+            __m512i zero[2 * L::num_streams];
+            for (auto& z : zero) z = _mm512_setzero_si512();
+            Hash::init(chain);
+            for (size_t blk = 0; blk < L::first_live_block; ++blk) {
+                __m512i w[16];
+                load_block<Hash, L>(blk, zero, w);
+                compress_from<Hash, 0>(chain, chain, w);
+            }
+            __m512i w[16];
+            load_block<Hash, L>(L::first_live_block, zero, w);
+            for (int k = 0; k < Hash::state_words; ++k) work[k] = chain[k];
+            Hash::template steps<0, L::prefix_steps>(work, w);
+        }
+    };
+
+    // Force-inlined like MD5::steps.
+    template <class Hash, class L>
+    inline __attribute__((always_inline)) void hash16(const __m512i words[2 * L::num_streams], __m512i st[Hash::state_words], const Midstate<Hash, L>& mid) {
+        for (int k = 0; k < Hash::state_words; ++k) st[k] = mid.chain[k];
+        for (size_t blk = L::first_live_block; blk < L::num_blocks; ++blk) {
+            __m512i w[16];
+            load_block<Hash, L>(blk, words, w);
+            if (blk == L::first_live_block) compress_from<Hash, L::prefix_steps>(st, mid.work, w);
+            else compress_from<Hash, 0>(st, st, w);
+        }
+    }
+
+    // Same contract as the md5-new solver: candidate n hashes the n-th output of
+    // every stream, and the smallest matching n is returned.
+    template <class Hash, class L>
+    uint64_t search(const uint64_t seeds[L::num_streams], const unsigned char target_bytes[]) {
+        uint32_t target[Hash::state_words];
+        for (int k = 0; k < Hash::state_words; ++k) {
+            const unsigned char* t = target_bytes + 4 * k;
+            target[k] = Hash::big_endian ? (uint32_t)t[0] << 24 | t[1] << 16 | t[2] << 8 | t[3]
+                                         : (uint32_t)t[3] << 24 | t[2] << 16 | t[1] << 8 | t[0];
+        }
+        const Midstate<Hash, L> mid;
+        std::atomic<uint64_t> min_found_n(ULLONG_MAX);
+        std::atomic<uint64_t> next_chunk(0);
+
+        reset_thread_rates();
+        #pragma omp parallel
+        {
+            pin_thread();
+            const double t0 = omp_get_wtime();
+            uint64_t hashed = 0;
+            uint64_t seek_chunk = 0;
+            uint64_t seek[L::num_streams];
+            for (size_t k = 0; k < L::num_streams; ++k) seek[k] = seeds[k];
+
+            for (;;) {
+                uint64_t chunk = next_chunk.fetch_add(1, std::memory_order_relaxed);
+                uint64_t current_n_base = chunk * CHUNK_SIZE + 1;
+                if (current_n_base >= min_found_n.load(std::memory_order_relaxed)) break;
+                for (size_t k = 0; k < L::num_streams; ++k) seek[k] = g_jump_table.advance(seek[k], (chunk - seek_chunk) * CHUNK_SIZE);
+                seek_chunk = chunk;
+                uint64_t state[L::num_streams];
+                for (size_t k = 0; k < L::num_streams; ++k) state[k] = seek[k];
+                const uint64_t chunk_end = current_n_base + CHUNK_SIZE;
+
+                while (current_n_base < chunk_end && current_n_base < min_found_n.load(std::memory_order_relaxed)) {
+                    __m512i words[2 * L::num_streams];
+                    for (size_t k = 0; k < L::num_streams; ++k) {
+                        alignas(64) uint64_t nums[SIMD_WIDTH];
+                        for (int i = 0; i < SIMD_WIDTH; ++i) { xorshift64(state[k]); nums[i] = state[k]; }
+                        __m512i v1 = _mm512_load_si512(&nums[0]), v2 = _mm512_load_si512(&nums[8]);
+                        words[2 * k] = _mm512_inserti64x4(_mm512_castsi256_si512(_mm512_cvtepi64_epi32(v1)), _mm512_cvtepi64_epi32(v2), 1);
+                        words[2 * k + 1] = _mm512_inserti64x4(_mm512_castsi256_si512(_mm512_cvtepi64_epi32(_mm512_srli_epi64(v1, 32))),
+                                                              _mm512_cvtepi64_epi32(_mm512_srli_epi64(v2, 32)), 1);
+                    }
+                    __m512i st[Hash::state_words];
+                    hash16<Hash, L>(words, st, mid);
+
+                    __mmask16 match_mask = 0xFFFF;
+                    for (int k = 0; k < Hash::state_words; ++k) {
+                        match_mask &= _mm512_cmpeq_epi32_mask(st[k], _mm512_set1_epi32(target[k]));
+                    }
+                    if (match_mask != 0) {
+                        uint64_t found_n = current_n_base + __builtin_ctz(match_mask);
+                        uint64_t prev_min = min_found_n.load(std::memory_order_relaxed);
+                        while (found_n < prev_min) { if (min_found_n.compare_exchange_weak(prev_min, found_n)) break; }
+                    }
+                    current_n_base += SIMD_WIDTH;
+                    hashed += SIMD_WIDTH;
                 }
-                match_mask = _mm512_cmpeq_epi32_mask(A3, constants.target_A) & _mm512_cmpeq_epi32_mask(B3, constants.target_B) & _mm512_cmpeq_epi32_mask(C3, constants.target_C) & _mm512_cmpeq_epi32_mask(D3, constants.target_D);
-                if (match_mask != 0) {
-                    int first_match_idx = __builtin_ctz(match_mask);
-                    uint64_t found_n = current_n_base + SIMD_WIDTH * 3 + first_match_idx;
-                    uint64_t prev_min = min_found_n.load(std::memory_order_relaxed);
-                    while (found_n < prev_min) { if (min_found_n.compare_exchange_weak(prev_min, found_n)) break; }
+            }
+            record_thread_rate(hashed, t0);
+        }
+        return min_found_n.load();
+    }
+
+    // The md5-new layout, and the same three streams zero-padded to a two-block record.
+    using Layout48 = Layout<48, 0, 4, 8>;
+    using Layout96 = Layout<96, 0, 4, 8>;
+    // Counter-style records: fixed leading words, streams packed at the end. These
+    // skip 6 steps (48 bytes) and the whole first block (96 bytes) via Midstate.
+    using LayoutTail48 = Layout<48, 6, 8, 10>;
+    using LayoutTail96 = Layout<96, 18, 20, 22>;
+}
+
+// --- Hit reporting ---
+// A full hit is a candidate whose digest equals the target. A partial hit agrees with
+// the target only on the partial_mask bits of word A; these feed collision statistics.
+struct Hit {
+    uint64_t n;
+    uint32_t digest[4];
+    bool full;
+};
+struct HitOptions {
+    uint64_t begin = 1, end = ULLONG_MAX; // candidates n in [begin, end)
+    uint64_t max_full = 1;                // stop after the first k full hits; 0 keeps every hit in range
+    uint32_t partial_mask = 0;            // word-A mask for partial hits; 0 disables them
+    uint32_t prefix_mask = 0;             // prefix searches: the word-A bits a full hit must match
+};
+
+// Searches candidates [opts.begin, opts.end) and returns the claim cutoff, which is the
+// smallest full hit when only one is wanted. With HITS, each thread appends hits to its
+// own buffer on the rare match path and the buffers are merged once at the end; the
+// plain search keeps none of that in its loop. With PREFIX a full hit only has to match
+// word A under opts.prefix_mask, a single masked compare per group.
+template <int GROUPS, bool HITS, bool PREFIX = false>
+uint64_t search_md5_48_impl(uint64_t s0, uint64_t s1, uint64_t s2, const unsigned char target_hash_bytes[16],
+                            const HitOptions& opts, std::vector<Hit>* hits) {
+    uint32_t target_hash_u32[4];
+    memcpy(target_hash_u32, target_hash_bytes, 16);
+
+    const __m512i target_A = _mm512_set1_epi32(target_hash_u32[0]), target_B = _mm512_set1_epi32(target_hash_u32[1]);
+    const __m512i target_C = _mm512_set1_epi32(target_hash_u32[2]), target_D = _mm512_set1_epi32(target_hash_u32[3]);
+    const __m512i partial_mask = _mm512_set1_epi32(opts.partial_mask);
+    const __m512i partial_target = _mm512_set1_epi32(target_hash_u32[0] & opts.partial_mask);
+    const __m512i prefix_mask = _mm512_set1_epi32(opts.prefix_mask);
+    const __m512i prefix_target = _mm512_set1_epi32(target_hash_u32[0] & opts.prefix_mask);
+
+    // min_found_n is the claim cutoff: no candidate past it is needed any more. It only
+    // drops once max_full full hits are known to lie at or below the new value, either
+    // because one thread found that many (each thread finds its hits in increasing n)
+    // or because that many were found overall and max_full_n bounds them all.
+    std::atomic<uint64_t> min_found_n(opts.end);
+    std::atomic<uint64_t> full_hits(0), max_full_n(0);
+    const uint64_t first_chunk = (opts.begin - 1) / CHUNK_SIZE;
+    std::atomic<uint64_t> next_chunk(first_chunk);
+    std::vector<std::vector<Hit>> thread_hits(HITS ? omp_get_max_threads() : 0);
+    reset_thread_rates();
+
+    // Threads claim contiguous ranges of CHUNK_SIZE candidates in increasing order.
+    // Once a hit is recorded no range starting past it is claimed, and ranges in
+    // flight stop at the hit, so every earlier candidate is still checked. When
+    // GROUPS * 16 does not divide CHUNK_SIZE the last block runs into the next
+    // range, which only rehashes a few candidates.
+    #pragma omp parallel
+    {
+        pin_thread();
+        const double t0 = omp_get_wtime();
+        uint64_t hashed = 0;
+        uint64_t seek_chunk = first_chunk;
+        uint64_t seek_s0 = g_jump_table.advance(s0, first_chunk * CHUNK_SIZE);
+        uint64_t seek_s1 = g_jump_table.advance(s1, first_chunk * CHUNK_SIZE);
+        uint64_t seek_s2 = g_jump_table.advance(s2, first_chunk * CHUNK_SIZE);
+        uint64_t local_full = 0;
+
+        alignas(64) uint32_t live[GROUPS][6][SIMD_WIDTH];
+
+        for (;;) {
+            uint64_t chunk = next_chunk.fetch_add(1, std::memory_order_relaxed);
+            uint64_t current_n_base = chunk * CHUNK_SIZE + 1;
+            if (current_n_base >= min_found_n.load(std::memory_order_relaxed)) break;
+            const uint64_t gap = (chunk - seek_chunk) * CHUNK_SIZE;
+            seek_s0 = g_jump_table.advance(seek_s0, gap);
+            seek_s1 = g_jump_table.advance(seek_s1, gap);
+            seek_s2 = g_jump_table.advance(seek_s2, gap);
+            seek_chunk = chunk;
+            uint64_t s0_block_start = seek_s0, s1_block_start = seek_s1, s2_block_start = seek_s2;
+            const uint64_t chunk_end = current_n_base + CHUNK_SIZE;
+
+            while (current_n_base < chunk_end && current_n_base < min_found_n.load(std::memory_order_relaxed)) {
+                generate_live_words<GROUPS>(s0_block_start, s1_block_start, s2_block_start, live);
+
+                __m512i digest[GROUPS][4];
+                md5_groups_48_byte<GROUPS, true>(live, digest);
+
+                for (int g = 0; g < GROUPS; ++g) {
+                    uint16_t match_mask = PREFIX ? _mm512_cmpeq_epi32_mask(_mm512_and_si512(digest[g][0], prefix_mask), prefix_target)
+                                          : _mm512_cmpeq_epi32_mask(digest[g][0], target_A) & _mm512_cmpeq_epi32_mask(digest[g][1], target_B) &
+                                            _mm512_cmpeq_epi32_mask(digest[g][2], target_C) & _mm512_cmpeq_epi32_mask(digest[g][3], target_D);
+                    uint16_t partial = 0;
+                    if (HITS && opts.partial_mask) partial = _mm512_cmpeq_epi32_mask(_mm512_and_si512(digest[g][0], partial_mask), partial_target);
+                    if ((match_mask | partial) == 0) continue;
+
+                    alignas(64) uint32_t lanes[4][SIMD_WIDTH];
+                    if (HITS) for (int k = 0; k < 4; ++k) _mm512_store_si512((__m512i*)lanes[k], digest[g][k]);
+                    for (uint32_t m = match_mask | partial; m != 0; m &= m - 1) {
+                        int lane = __builtin_ctz(m);
+                        uint64_t found_n = current_n_base + SIMD_WIDTH * g + lane;
+                        // Lanes past chunk_end belong to the next range and are reported there.
+                        if (found_n < opts.begin || found_n >= opts.end || found_n >= chunk_end) continue;
+                        bool full = (match_mask >> lane) & 1;
+                        if (HITS) thread_hits[omp_get_thread_num()].push_back({found_n, {lanes[0][lane], lanes[1][lane], lanes[2][lane], lanes[3][lane]}, full});
+                        if (!full || opts.max_full == 0) continue;
+                        uint64_t prev_max = max_full_n.load();
+                        while (found_n > prev_max && !max_full_n.compare_exchange_weak(prev_max, found_n)) {}
+                        uint64_t bound = ++local_full == opts.max_full ? found_n : ULLONG_MAX;
+                        if (full_hits.fetch_add(1) + 1 >= opts.max_full) bound = std::min(bound, max_full_n.load());
+                        uint64_t prev_min = min_found_n.load(std::memory_order_relaxed);
+                        while (bound < prev_min) { if (min_found_n.compare_exchange_weak(prev_min, bound)) break; }
+                    }
                 }
-                
-                s0_block_start = transform_lut(s0_block_start);
-                s1_block_start = transform_lut(s1_block_start);
-                s2_block_start = transform_lut(s2_block_start);
-                
-                current_n_base += (uint64_t)omp_get_num_threads() * SIMD_WIDTH * 4;
+
+                current_n_base += SIMD_WIDTH * GROUPS;
+                hashed += SIMD_WIDTH * GROUPS;
             }
         }
-        std::cout << min_found_n.load() << std::endl;
+        record_thread_rate(hashed, t0);
     }
-    return 0;
-}
\ No newline at end of file
+
+    // Everything up to the k-th full hit was scanned, so the merged list is cut there.
+    if (HITS) {
+        for (auto& local : thread_hits) hits->insert(hits->end(), local.begin(), local.end());
+        std::sort(hits->begin(), hits->end(), [](const Hit& a, const Hit& b) { return a.n < b.n; });
+        uint64_t full_seen = 0;
+        for (size_t i = 0; i < hits->size(); ++i) {
+            if ((*hits)[i].full && ++full_seen == opts.max_full) { hits->resize(i + 1); break; }
+        }
+    }
+    return min_found_n.load();
+}
+
+// Returns the smallest n whose 48-byte candidate hashes to target_hash_bytes.
+template <int GROUPS>
+uint64_t search_md5_48(uint64_t s0, uint64_t s1, uint64_t s2, const unsigned char target_hash_bytes[16]) {
+    return search_md5_48_impl<GROUPS, false>(s0, s1, s2, target_hash_bytes, HitOptions(), nullptr);
+}
+
+// Returns the smallest n whose digest matches target_hash_bytes on the bits of
+// prefix_mask, a word-A mask in digest byte order (proof-of-work style targets).
+template <int GROUPS>
+uint64_t search_md5_48_prefix(uint64_t s0, uint64_t s1, uint64_t s2, const unsigned char target_hash_bytes[16],
+                              uint32_t prefix_mask) {
+    HitOptions opts;
+    opts.prefix_mask = prefix_mask;
+    return search_md5_48_impl<GROUPS, false, true>(s0, s1, s2, target_hash_bytes, opts, nullptr);
+}
+
+template <int GROUPS>
+std::vector<Hit> search_md5_48_hits(uint64_t s0, uint64_t s1, uint64_t s2, const unsigned char target_hash_bytes[16],
+                                    const HitOptions& opts) {
+    std::vector<Hit> hits;
+    search_md5_48_impl<GROUPS, true>(s0, s1, s2, target_hash_bytes, opts, &hits);
+    return hits;
+}
+
+// Kernel-only loop over fixed candidates; shared by the auto-tuner and --bench.
+template <int GROUPS, bool TERNLOG = true>
+uint32_t bench_groups(uint64_t calls) {
+    alignas(64) uint32_t live[GROUPS][6][SIMD_WIDTH] = {};
+    uint32_t sink = 0;
+    for (uint64_t c = 0; c < calls; ++c) {
+        __m512i digest[GROUPS][4];
+        for (int g = 0; g < GROUPS; ++g) live[g][0][0] = (uint32_t)c;
+        md5_groups_48_byte<GROUPS, TERNLOG>(live, digest);
+        for (int g = 0; g < GROUPS; ++g) sink += (uint32_t)_mm512_reduce_add_epi32(digest[g][0]);
+    }
+    return sink;
+}
+
+// --- Interleave auto-tuner ---
+// The best number of independent chains depends on how many vector ports the core
+// has and on register pressure, so each factor is timed briefly on this CPU. Two
+// threads per core split the ports, which usually favours a smaller factor.
+using SearchMd5Fn = uint64_t (*)(uint64_t, uint64_t, uint64_t, const unsigned char*);
+using HitsMd5Fn = std::vector<Hit> (*)(uint64_t, uint64_t, uint64_t, const unsigned char*, const HitOptions&);
+using PrefixMd5Fn = uint64_t (*)(uint64_t, uint64_t, uint64_t, const unsigned char*, uint32_t);
+struct GroupVariant {
+    int groups;
+    SearchMd5Fn search;
+    HitsMd5Fn hits;
+    PrefixMd5Fn prefix;
+    uint32_t (*bench)(uint64_t calls);
+};
+static const GroupVariant group_variants[] = {
+    {2, search_md5_48<2>, search_md5_48_hits<2>, search_md5_48_prefix<2>, bench_groups<2>},
+    {4, search_md5_48<4>, search_md5_48_hits<4>, search_md5_48_prefix<4>, bench_groups<4>},
+    {6, search_md5_48<6>, search_md5_48_hits<6>, search_md5_48_prefix<6>, bench_groups<6>},
+    {8, search_md5_48<8>, search_md5_48_hits<8>, search_md5_48_prefix<8>, bench_groups<8>},
+};
+
+const GroupVariant& autotune_groups(double seconds_per_variant, int threads) {
+    const GroupVariant* best = &group_variants[1];
+    double best_rate = 0;
+    for (const GroupVariant& v : group_variants) {
+        uint64_t calls = 0;
+        double elapsed = 0;
+        // Every thread runs the variant at once, so SMT siblings sharing a core's
+        // vector ports are measured as they will search.
+        #pragma omp parallel num_threads(threads) reduction(+ : calls) reduction(max : elapsed)
+        {
+            pin_thread();
+            volatile uint32_t sink = v.bench(16); // warm up
+            double t0 = omp_get_wtime();
+            do {
+                sink = v.bench(64);
+                calls += 64;
+                elapsed = omp_get_wtime() - t0;
+            } while (elapsed < seconds_per_variant);
+            (void)sink;
+        }
+        double rate = (double)calls * v.groups / elapsed;
+        if (rate > best_rate) { best_rate = rate; best = &v; }
+    }
+    return *best;
+}
+
+// --- Kernel throughput benchmark (--bench) ---
+// Each variant hashes a fixed set of candidates in a loop, so kernel cost is measured
+// apart from candidate generation (the "generate" row) and from the search loop.
+// Every thread runs the same number of calls, and the thread count is doubled up to
+// the OpenMP maximum.
+struct BenchVariant {
+    const char* name;
+    int hashes_per_call;
+    uint32_t (*run)(uint64_t calls); // returns a digest fold
+};
+
+inline uint32_t fold_digest(__m512i v) { return (uint32_t)_mm512_reduce_add_epi32(v); }
+
+// The fallback kernels, timed here for comparison with the AVX-512 rows.
+template <class Kernel>
+uint32_t bench_fallback(uint64_t calls) {
+    alignas(64) uint32_t live[6][Kernel::lanes] = {};
+    alignas(64) uint32_t digest[4][Kernel::lanes];
+    uint32_t sink = 0;
+    for (uint64_t c = 0; c < calls; ++c) {
+        for (int l = 0; l < Kernel::lanes; ++l) live[0][l] = (uint32_t)c + l;
+        Kernel::hash(live, digest);
+        for (int l = 0; l < Kernel::lanes; ++l) sink += digest[0][l];
+    }
+    return sink;
+}
+
+// Generic engine, MD5 on layout L; the tail layouts show the shared-prefix saving.
+template <class L>
+uint32_t bench_engine(uint64_t calls) {
+    const HashEngine::Midstate<HashEngine::MD5, L> mid;
+    __m512i words[6];
+    for (int k = 0; k < 6; ++k) words[k] = _mm512_set1_epi32(0x9e3779b9 * (k + 1));
+    uint32_t sink = 0;
+    for (uint64_t c = 0; c < calls; ++c) {
+        __m512i st[4];
+        words[0] = _mm512_add_epi32(words[0], _mm512_set1_epi32(1));
+        HashEngine::hash16<HashEngine::MD5, L>(words, st, mid);
+        sink += fold_digest(st[0]);
+    }
+    return sink;
+}
+
+static const BenchVariant bench_variants[] = {
+    {"x1", SIMD_WIDTH, bench_engine<HashEngine::Layout48>},
+    {"x1-tail48", SIMD_WIDTH, bench_engine<HashEngine::LayoutTail48>},
+    {"x1-96", SIMD_WIDTH, bench_engine<HashEngine::Layout96>},
+    {"x1-tail96", SIMD_WIDTH, bench_engine<HashEngine::LayoutTail96>},
+    {"g2", SIMD_WIDTH * 2, bench_groups<2>},
+    {"g4", SIMD_WIDTH * 4, bench_groups<4>},
+    {"g4-boolean", SIMD_WIDTH * 4, bench_groups<4, false>},
+    {"g6", SIMD_WIDTH * 6, bench_groups<6>},
+    {"g8", SIMD_WIDTH * 8, bench_groups<8>},
+    {"avx2", Md5Avx2Kernel::lanes, bench_fallback<Md5Avx2Kernel>},
+    {"portable", Md5PortableKernel::lanes, bench_fallback<Md5PortableKernel>},
+    {"generate", SIMD_WIDTH * 4, [](uint64_t calls) {
+        alignas(64) uint32_t live[4][6][SIMD_WIDTH];
+        uint64_t s0 = 1, s1 = 2, s2 = 3;
+        uint32_t sink = 0;
+        for (uint64_t c = 0; c < calls; ++c) {
+            generate_live_words<4>(s0, s1, s2, live);
+            sink += live[3][5][SIMD_WIDTH - 1];
+        }
+        return sink;
+    }},
+};
+
+void run_benchmark(double seconds_per_run) {
+    std::vector<int> thread_counts;
+    int max_threads = omp_get_max_threads();
+    for (int t = 1; t < max_threads; t *= 2) thread_counts.push_back(t);
+    thread_counts.push_back(max_threads);
+
+    std::cout << "variant,threads,hashes,seconds,ghash_per_s,mhash_per_s_per_thread" << std::endl;
+    for (const BenchVariant& v : bench_variants) {
+        // Calibrate on one thread so each run takes roughly seconds_per_run.
+        uint64_t calls = 1024;
+        for (;;) {
+            double t0 = omp_get_wtime();
+            volatile uint32_t sink = v.run(calls);
+            (void)sink;
+            double elapsed = omp_get_wtime() - t0;
+            if (elapsed >= seconds_per_run / 4) { calls = (uint64_t)(calls * seconds_per_run / elapsed) + 1; break; }
+            calls *= 4;
+        }
+        for (int threads : thread_counts) {
+            double t0 = omp_get_wtime();
+            #pragma omp parallel num_threads(threads)
+            {
+                pin_thread();
+                volatile uint32_t sink = v.run(calls);
+                (void)sink;
+            }
+            double elapsed = omp_get_wtime() - t0;
+            double hashes = (double)calls * v.hashes_per_call * threads;
+            std::cout << v.name << "," << threads << "," << (uint64_t)hashes << "," << std::fixed << std::setprecision(4) << elapsed << ","
+                      << hashes / elapsed / 1e9 << "," << hashes / elapsed / 1e6 / threads << std::defaultfloat << std::endl;
+        }
+    }
+}
+
+// --- Scalar reference and differential self-test (--selftest) ---
+// The scalar reference, checked against the RFC test suite first, is the oracle for
+// every SIMD path: each kernel lane is compared on random candidates, and each search
+// path must find a target planted at a random n (and hence a random lane and group).
+int run_selftest(int iterations) {
+    int checks = 0, failures = 0;
+    auto check = [&](bool ok, const std::string& what) {
+        ++checks;
+        if (!ok && failures++ < 20) std::cerr << "selftest FAILED: " << what << std::endl;
+    };
+    auto hex = [](const unsigned char* p, size_t n) {
+        std::ostringstream ss;
+        for (size_t i = 0; i < n; ++i) ss << std::hex << std::setw(2) << std::setfill('0') << (int)p[i];
+        return ss.str();
+    };
+
+    static const char* rfc_suite[][2] = {
+        {"", "d41d8cd98f00b204e9800998ecf8427e"},
+        {"a", "0cc175b9c0f1b6a831c399e269772661"},
+        {"abc", "900150983cd24fb0d6963f7d28e17f72"},
+        {"message digest", "f96b697d7cb7938d525a2f31aaf161d0"},
+        {"abcdefghijklmnopqrstuvwxyz", "c3fcd3d76192e4007dfb496cca67e13b"},
+        {"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789", "d174ab98d277d9f5a5611c2c9f419d9f"},
+        {"12345678901234567890123456789012345678901234567890123456789012345678901234567890", "57edf4a22be3c955ac49da2e2107b67a"},
+    };
+    for (auto& tv : rfc_suite) {
+        unsigned char d[16];
+        md5_scalar((const unsigned char*)tv[0], strlen(tv[0]), d);
+        check(hex(d, 16) == tv[1], std::string("md5_scalar(\"") + tv[0] + "\")");
+    }
+
+    std::mt19937_64 rng(0x5eed);
+    for (int it = 0; it < iterations; ++it) {
+        uint64_t s0 = rng(), s1 = rng(), s2 = rng();
+
+        // Interleave-templated kernels: every lane of every group.
+        for (const GroupVariant& v : group_variants) {
+            alignas(64) uint32_t live[8][6][SIMD_WIDTH];
+            __m512i digest[8][4];
+            uint64_t g0 = s0, g1 = s1, g2 = s2;
+            switch (v.groups) {
+                case 2: generate_live_words<2>(g0, g1, g2, live); md5_groups_48_byte<2, true>(live, digest); break;
+                case 4: generate_live_words<4>(g0, g1, g2, live); md5_groups_48_byte<4, true>(live, digest); break;
+                case 6: generate_live_words<6>(g0, g1, g2, live); md5_groups_48_byte<6, true>(live, digest); break;
+                default: generate_live_words<8>(g0, g1, g2, live); md5_groups_48_byte<8, true>(live, digest); break;
+            }
+            for (int lane = 0; lane < SIMD_WIDTH * v.groups; ++lane) {
+                unsigned char msg[48], expect[16];
+                candidate_message(s0, s1, s2, lane + 1, msg);
+                md5_scalar(msg, 48, expect);
+                alignas(64) uint32_t got[4][SIMD_WIDTH];
+                for (int k = 0; k < 4; ++k) _mm512_store_si512((__m512i*)got[k], digest[lane / SIMD_WIDTH][k]);
+                uint32_t lane_digest[4] = {got[0][lane % SIMD_WIDTH], got[1][lane % SIMD_WIDTH], got[2][lane % SIMD_WIDTH], got[3][lane % SIMD_WIDTH]};
+                check(memcmp(lane_digest, expect, 16) == 0, "g" + std::to_string(v.groups) + " lane " + std::to_string(lane));
+            }
+        }
+
+        // The boolean-op form of the 4-group kernel on every lane, and the engine on group 0.
+        alignas(64) uint32_t live[4][6][SIMD_WIDTH];
+        uint64_t g0 = s0, g1 = s1, g2 = s2;
+        generate_live_words<4>(g0, g1, g2, live);
+        __m512i digest[4][4];
+        md5_groups_48_byte<4, false>(live, digest);
+        __m512i words[6];
+        for (int k = 0; k < 6; ++k) words[k] = _mm512_load_si512((const __m512i*)live[0][k]);
+        __m512i engine_st[4];
+        HashEngine::hash16<HashEngine::MD5, HashEngine::Layout48>(words, engine_st, HashEngine::Midstate<HashEngine::MD5, HashEngine::Layout48>());
+        for (int lane = 0; lane < SIMD_WIDTH * 4; ++lane) {
+            unsigned char msg[48], expect[16];
+            candidate_message(s0, s1, s2, lane + 1, msg);
+            md5_scalar(msg, 48, expect);
+            alignas(64) uint32_t got[4][SIMD_WIDTH];
+            for (int k = 0; k < 4; ++k) _mm512_store_si512((__m512i*)got[k], digest[lane / SIMD_WIDTH][k]);
+            uint32_t lane_digest[4] = {got[0][lane % SIMD_WIDTH], got[1][lane % SIMD_WIDTH], got[2][lane % SIMD_WIDTH], got[3][lane % SIMD_WIDTH]};
+            check(memcmp(lane_digest, expect, 16) == 0, "g4-boolean lane " + std::to_string(lane));
+            if (lane < SIMD_WIDTH) {
+                for (int k = 0; k < 4; ++k) _mm512_store_si512((__m512i*)got[k], engine_st[k]);
+                uint32_t engine_digest[4] = {got[0][lane], got[1][lane], got[2][lane], got[3][lane]};
+                check(memcmp(engine_digest, expect, 16) == 0, "engine md5 lane " + std::to_string(lane));
+            }
+        }
+
+        // Fallback kernels: every lane.
+        auto check_fallback = [&](auto kernel, const std::string& name) {
+            using Kernel = decltype(kernel);
+            alignas(64) uint32_t live[6][Kernel::lanes];
+            alignas(64) uint32_t got[4][Kernel::lanes];
+            uint64_t f0 = s0, f1 = s1, f2 = s2;
+            fallback_live_words<Kernel>(f0, f1, f2, live);
+            Kernel::hash(live, got);
+            for (int lane = 0; lane < Kernel::lanes; ++lane) {
+                unsigned char msg[48], expect[16];
+                candidate_message(s0, s1, s2, lane + 1, msg);
+                md5_scalar(msg, 48, expect);
+                uint32_t lane_digest[4] = {got[0][lane], got[1][lane], got[2][lane], got[3][lane]};
+                check(memcmp(lane_digest, expect, 16) == 0, name + " lane " + std::to_string(lane));
+            }
+        };
+        check_fallback(Md5Avx2Kernel{}, "avx2");
+        check_fallback(Md5PortableKernel{}, "portable");
+
+        // Stream seek: one table jump against n single steps, and jumps composing for large n.
+        uint64_t seek_n = rng() % (2 * CHUNK_SIZE), walked = s0;
+        for (uint64_t i = 0; i < seek_n; ++i) xorshift64(walked);
+        check(g_jump_table.advance(s0, seek_n) == walked, "advance n=" + std::to_string(seek_n));
+        uint64_t jump_a = rng() >> 1, jump_b = rng() >> 1;
+        check(g_jump_table.advance(g_jump_table.advance(s0, jump_a), jump_b) == g_jump_table.advance(s0, jump_a + jump_b),
+              "advance composition " + std::to_string(jump_a) + "+" + std::to_string(jump_b));
+
+        // Search paths: the planted n must come back exactly, whatever lane, group and chunk it falls in.
+        uint64_t planted = 1 + rng() % (3 * CHUNK_SIZE);
+        unsigned char msg[48], target[16];
+        candidate_message(s0, s1, s2, planted, msg);
+        md5_scalar(msg, 48, target);
+        uint64_t seeds[3] = {s0, s1, s2};
+        for (const GroupVariant& v : group_variants) {
+            check(v.search(s0, s1, s2, target) == planted,
+                  "search_md5_48<" + std::to_string(v.groups) + "> planted n=" + std::to_string(planted));
+        }
+        check(search_md5_48_fallback<Md5Avx2Kernel>(s0, s1, s2, target) == planted, "avx2 search planted n=" + std::to_string(planted));
+        check(search_md5_48_fallback<Md5PortableKernel>(s0, s1, s2, target) == planted, "portable search planted n=" + std::to_string(planted));
+        check(HashEngine::search<HashEngine::MD5, HashEngine::Layout48>(seeds, target) == planted, "engine search planted n=" + std::to_string(planted));
+
+        // Hit lists on a bounded range around the planted n, with the low byte of word A
+        // as the partial mask: all hits in range, then only those up to the first full hit.
+        HitOptions all_hits;
+        all_hits.begin = planted > 1000 ? planted - 1000 : 1;
+        all_hits.end = planted + 1000;
+        all_hits.max_full = 0;
+        all_hits.partial_mask = 0xFF;
+        std::vector<std::pair<uint64_t, bool>> expect_all, expect_first;
+        uint64_t w0 = s0, w1 = s1, w2 = s2;
+        for (uint64_t n = 1; n < all_hits.end; ++n) {
+            xorshift64(w0); xorshift64(w1); xorshift64(w2);
+            if (n < all_hits.begin) continue;
+            unsigned char m[48] = {}, d[16];
+            memcpy(m, &w0, 8); memcpy(m + 16, &w1, 8); memcpy(m + 32, &w2, 8);
+            md5_scalar(m, 48, d);
+            if (d[0] != target[0]) continue;
+            expect_all.push_back({n, memcmp(d, target, 16) == 0});
+            if (n <= planted) expect_first.push_back(expect_all.back());
+        }
+        HitOptions first_hit = all_hits;
+        first_hit.max_full = 1;
+        for (const GroupVariant& v : group_variants) {
+            for (int pass = 0; pass < 2; ++pass) {
+                std::vector<Hit> hits = v.hits(s0, s1, s2, target, pass ? first_hit : all_hits);
+                std::vector<std::pair<uint64_t, bool>> got;
+                for (const Hit& h : hits) got.push_back({h.n, h.full});
+                check(got == (pass ? expect_first : expect_all), "search_md5_48_hits<" + std::to_string(v.groups) + "> " +
+                      (pass ? "first" : "all") + " planted n=" + std::to_string(planted));
+            }
+        }
+
+        // --thread-stats: a hit-list search records every thread, and the whole range is counted.
+        const bool thread_stats = g_thread_stats;
+        g_thread_stats = true;
+        group_variants[0].hits(s0, s1, s2, target, all_hits);
+        uint64_t counted = 0;
+        for (const ThreadRate& r : g_thread_rates) counted += r.candidates;
+        check((int)g_thread_rates.size() == omp_get_max_threads() && counted >= all_hits.end - all_hits.begin,
+              "thread stats after search_md5_48_hits planted n=" + std::to_string(planted));
+        g_thread_stats = thread_stats;
+
+        // Prefix search on the first 12 bits of the digest against a scalar scan.
+        const unsigned char prefix_bytes[4] = {0xFF, 0xF0, 0, 0};
+        uint32_t prefix_mask, target_a;
+        memcpy(&prefix_mask, prefix_bytes, 4);
+        memcpy(&target_a, target, 4);
+        uint64_t expect_prefix = 0;
+        w0 = s0; w1 = s1; w2 = s2;
+        for (uint64_t n = 1; !expect_prefix; ++n) {
+            xorshift64(w0); xorshift64(w1); xorshift64(w2);
+            unsigned char m[48] = {};
+            uint32_t d[4];
+            memcpy(m, &w0, 8); memcpy(m + 16, &w1, 8); memcpy(m + 32, &w2, 8);
+            md5_scalar(m, 48, (unsigned char*)d);
+            if (((d[0] ^ target_a) & prefix_mask) == 0) expect_prefix = n;
+        }
+        for (const GroupVariant& v : group_variants) {
+            check(v.prefix(s0, s1, s2, target, prefix_mask) == expect_prefix,
+                  "search_md5_48_prefix<" + std::to_string(v.groups) + "> expected n=" + std::to_string(expect_prefix));
+        }
+
+        // Multi-block engine path against a two-block reference message.
+        unsigned char long_msg[96] = {};
+        memcpy(long_msg, msg, 48);
+        md5_scalar(long_msg, 96, target);
+        check(HashEngine::search<HashEngine::MD5, HashEngine::Layout96>(seeds, target) == planted, "engine 96-byte search planted n=" + std::to_string(planted));
+
+        // Tail layouts go through the shared-prefix midstate.
+        unsigned char tail_msg[96] = {};
+        memcpy(tail_msg + 24, msg, 8); memcpy(tail_msg + 32, msg + 16, 8); memcpy(tail_msg + 40, msg + 32, 8);
+        md5_scalar(tail_msg, 48, target);
+        check(HashEngine::search<HashEngine::MD5, HashEngine::LayoutTail48>(seeds, target) == planted, "engine tail48 search planted n=" + std::to_string(planted));
+        memset(tail_msg, 0, sizeof(tail_msg));
+        memcpy(tail_msg + 72, msg, 8); memcpy(tail_msg + 80, msg + 16, 8); memcpy(tail_msg + 88, msg + 32, 8);
+        md5_scalar(tail_msg, 96, target);
+        check(HashEngine::search<HashEngine::MD5, HashEngine::LayoutTail96>(seeds, target) == planted, "engine tail96 search planted n=" + std::to_string(planted));
+    }
+
+    std::cout << "selftest: " << checks - failures << "/" << checks << " checks passed" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
+
+// The full solver: engine, bench and self-test modes, and the tuned 16-lane search.
+int run_avx512(int argc, char** argv) {
+    // --engine md5|sha1|sha256 [--len 48|96] [--tail] runs the generic engine on every query
+    //   in stdin; --tail packs the streams at the end of the record (HashEngine::LayoutTail*).
+    // --bench [--bench-time SEC] prints kernel throughput as CSV instead of solving.
+    // --selftest [--iters N] checks every SIMD path against the scalar reference.
+    // --groups 2|4|6|8 fixes the interleave factor instead of auto-tuning it.
+    // --hits K [--range BEGIN END] [--partial-mask HEX] lists the first K full hits of each
+    //   query (K = 0: every hit in the range) and the partial hits before the last of them,
+    //   one "n digest full|partial" line each after a "# query i" header.
+    // --prefix-bits B | --prefix-mask HEX prints the first n whose digest matches the
+    //   query target on its first B bits (1 <= B <= 32) or on a nonzero word-A byte mask,
+    //   with the measured rate and the expected time per hit at that difficulty on stderr.
+    //   It cannot be combined with --hits.
+    std::string engine_hash, engine_len = "48";
+    bool bench = false, selftest = false, tail = false;
+    double bench_time = 0.2;
+    int selftest_iters = 20;
+    int groups = 0;
+    bool list_hits = false;
+    HitOptions hit_opts;
+    uint32_t prefix_mask = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--bench") == 0) bench = true;
+        else if (strcmp(argv[i], "--selftest") == 0) selftest = true;
+        else if (strcmp(argv[i], "--iters") == 0 && i + 1 < argc) selftest_iters = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--groups") == 0 && i + 1 < argc) {
+            groups = atoi(argv[++i]);
+            if (std::none_of(std::begin(group_variants), std::end(group_variants), [&](const GroupVariant& v) { return v.groups == groups; })) {
+                std::cerr << "unsupported --groups " << argv[i] << " (expected 2, 4, 6 or 8)" << std::endl;
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--engine") == 0 && i + 1 < argc) engine_hash = argv[++i];
+        else if (strcmp(argv[i], "--len") == 0 && i + 1 < argc) engine_len = argv[++i];
+        else if (strcmp(argv[i], "--tail") == 0) tail = true;
+        else if (strcmp(argv[i], "--hits") == 0 && i + 1 < argc) { list_hits = true; hit_opts.max_full = strtoull(argv[++i], NULL, 10); }
+        else if (strcmp(argv[i], "--range") == 0 && i + 2 < argc) {
+            hit_opts.begin = std::max(1ULL, strtoull(argv[i + 1], NULL, 10));
+            hit_opts.end = strtoull(argv[i + 2], NULL, 10);
+            i += 2;
+        }
+        else if (strcmp(argv[i], "--partial-mask") == 0 && i + 1 < argc) hit_opts.partial_mask = (uint32_t)strtoul(argv[++i], NULL, 16);
+        else if (strcmp(argv[i], "--prefix-bits") == 0 && i + 1 < argc) {
+            int bits = atoi(argv[++i]);
+            if (bits < 1 || bits > 32) { std::cerr << "--prefix-bits " << argv[i] << " is out of range (1 to 32)" << std::endl; return 1; }
+            unsigned char mask_bytes[4] = {};
+            for (int b = 0; b < bits; ++b) mask_bytes[b / 8] |= 0x80 >> (b % 8);
+            memcpy(&prefix_mask, mask_bytes, 4);
+        }
+        else if (strcmp(argv[i], "--prefix-mask") == 0 && i + 1 < argc) {
+            unsigned char mask_bytes[4] = {};
+            hex_to_bytes(std::string(argv[++i]).substr(0, 8), mask_bytes);
+            memcpy(&prefix_mask, mask_bytes, 4);
+            if (prefix_mask == 0) { std::cerr << "--prefix-mask " << argv[i] << " selects no bits" << std::endl; return 1; }
+        }
+        else if (strcmp(argv[i], "--bench-time") == 0 && i + 1 < argc) bench_time = atof(argv[++i]);
+        // Handled in main.
+        else if ((strcmp(argv[i], "--isa") == 0 || strcmp(argv[i], "--placement") == 0) && i + 1 < argc) ++i;
+        else if (strcmp(argv[i], "--thread-stats") == 0) continue;
+        else {
+            std::cerr << "bad argument " << argv[i] << " (unknown option or missing value)" << std::endl;
+            return 1;
+        }
+    }
+    if (prefix_mask != 0 && list_hits) {
+        std::cerr << "--prefix-bits/--prefix-mask cannot be combined with --hits" << std::endl;
+        return 1;
+    }
+    if (bench) {
+        run_benchmark(bench_time);
+        return 0;
+    }
+    if (selftest) return run_selftest(selftest_iters);
+    if (!engine_hash.empty()) {
+        using SearchFn = uint64_t (*)(const uint64_t*, const unsigned char*);
+        auto pick = [&](auto layout) -> SearchFn {
+            using L = decltype(layout);
+            if (engine_hash == "md5") return HashEngine::search<HashEngine::MD5, L>;
+            if (engine_hash == "sha1") return HashEngine::search<HashEngine::SHA1, L>;
+            if (engine_hash == "sha256") return HashEngine::search<HashEngine::SHA256, L>;
+            return nullptr;
+        };
+        SearchFn fn = nullptr;
+        if (engine_len == "48") fn = tail ? pick(HashEngine::LayoutTail48{}) : pick(HashEngine::Layout48{});
+        else if (engine_len == "96") fn = tail ? pick(HashEngine::LayoutTail96{}) : pick(HashEngine::Layout96{});
+        if (!fn) { std::cerr << "unsupported --engine " << engine_hash << " --len " << engine_len << std::endl; return 1; }
+        std::string s0_hex, s1_hex, s2_hex, target_hash_hex;
+        for (int q = 0; std::cin >> s0_hex >> s1_hex >> s2_hex >> target_hash_hex; ++q) {
+            uint64_t seeds[3] = {hex_to_u64(s0_hex), hex_to_u64(s1_hex), hex_to_u64(s2_hex)};
+            unsigned char target_bytes[32] = {};
+            hex_to_bytes(target_hash_hex, target_bytes);
+            std::cout << fn(seeds, target_bytes) << std::endl;
+            if (g_thread_stats) print_thread_rates(q);
+        }
+        return 0;
+    }
+    
+    const GroupVariant* search_variant = nullptr;
+    for (const GroupVariant& v : group_variants) if (v.groups == groups) search_variant = &v;
+    if (!search_variant) search_variant = &autotune_groups(0.002, g_thread_cpus.empty() ? 1 : (int)g_thread_cpus.size());
+
+    if (prefix_mask != 0) {
+        const int bits = __builtin_popcount(prefix_mask);
+        std::string s0_hex, s1_hex, s2_hex, target_hash_hex;
+        for (int q = 0; std::cin >> s0_hex >> s1_hex >> s2_hex >> target_hash_hex; ++q) {
+            unsigned char target_hash_bytes[16] = {};
+            hex_to_bytes(target_hash_hex.substr(0, 32), target_hash_bytes);
+            double t0 = omp_get_wtime();
+            uint64_t n = search_variant->prefix(hex_to_u64(s0_hex), hex_to_u64(s1_hex), hex_to_u64(s2_hex), target_hash_bytes, prefix_mask);
+            double elapsed = omp_get_wtime() - t0;
+            std::cout << n << std::endl;
+            // Candidates through n over wall time; each hit costs 2^bits candidates on average.
+            double rate = (double)n / elapsed;
+            std::cerr << "prefix " << bits << " bits: " << n << " candidates in " << std::fixed << std::setprecision(4) << elapsed << " s, "
+                      << rate / 1e6 << " MH/s, expected " << std::ldexp(1.0, bits) / rate << " s per hit at this difficulty"
+                      << std::defaultfloat << std::endl;
+            if (g_thread_stats) print_thread_rates(q);
+        }
+        return 0;
+    }
+
+    if (list_hits) {
+        // Past the first, full hits may never come, so only K = 1 may search without bound.
+        if (hit_opts.max_full != 1 && hit_opts.end == ULLONG_MAX) {
+            std::cerr << "--hits " << hit_opts.max_full << " needs a bounded --range" << std::endl;
+            return 1;
+        }
+        std::string s0_hex, s1_hex, s2_hex, target_hash_hex;
+        for (int q = 0; std::cin >> s0_hex >> s1_hex >> s2_hex >> target_hash_hex; ++q) {
+            unsigned char target_hash_bytes[16];
+            hex_to_bytes(target_hash_hex, target_hash_bytes);
+            std::vector<Hit> hits = search_variant->hits(hex_to_u64(s0_hex), hex_to_u64(s1_hex), hex_to_u64(s2_hex), target_hash_bytes, hit_opts);
+            std::cout << "# query " << q << "\n";
+            for (const Hit& h : hits) {
+                std::cout << h.n << " ";
+                for (int b = 0; b < 16; ++b) std::cout << std::hex << std::setw(2) << std::setfill('0') << (int)((const unsigned char*)h.digest)[b];
+                std::cout << std::dec << (h.full ? " full" : " partial") << "\n";
+            }
+            if (g_thread_stats) { std::cout << std::flush; print_thread_rates(q); }
+        }
+        std::cout << std::flush;
+        return 0;
+    }
+
+    return solve_stdin([&](uint64_t s0, uint64_t s1, uint64_t s2, const unsigned char* target) {
+        return search_variant->search(s0, s1, s2, target);
+    });
+}
+#pragma GCC pop_options
+
+// --- Runtime ISA dispatch ---
+// A binary built for a baseline -march (e.g. -march=x86-64-v2) runs on any node:
+// AVX-512 code is only entered when the CPU has it, otherwise the AVX2 or portable
+// kernel solves the queries. --isa avx512|avx2|portable picks a lower tier by hand.
+enum class Isa { Portable, Avx2, Avx512 };
+
+Isa detect_isa() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq") &&
+        __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl")) return Isa::Avx512;
+    if (__builtin_cpu_supports("avx2")) return Isa::Avx2;
+    return Isa::Portable;
+}
+
+int main(int argc, char** argv) {
+    std::ios_base::sync_with_stdio(false);
+    std::cin.tie(NULL);
+
+    g_jump_table.build(XorshiftJump::get_xorshift_matrix());
+
+    Isa isa = detect_isa();
+    // Bench/selftest/engine and the hit-list, partial, prefix and tail search modes
+    // only exist on the AVX-512 path; the fallback kernels solve plain 48-byte queries.
+    static const char* const avx512_only_flags[] = {
+        "--bench", "--bench-time", "--selftest", "--iters", "--engine", "--len", "--tail", "--groups",
+        "--hits", "--range", "--partial-mask", "--prefix-bits", "--prefix-mask"};
+    const char* avx512_only_flag = nullptr;
+    const char* bad_arg = nullptr; // run_avx512 checks its own arguments
+    // --placement cores|smt pins one thread per physical core or per hardware thread;
+    // --thread-stats prints each thread's candidate rate on stderr after every query.
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--placement") == 0 && i + 1 < argc) {
+            std::string want = argv[++i];
+            if (want != "cores" && want != "smt") { std::cerr << "unknown --placement " << want << std::endl; return 1; }
+            set_placement(want == "cores" ? Placement::Cores : Placement::Smt);
+        } else if (strcmp(argv[i], "--thread-stats") == 0) g_thread_stats = true;
+    }
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--isa") == 0) {
+            if (i + 1 == argc) { std::cerr << "--isa needs a value (avx512, avx2 or portable)" << std::endl; return 1; }
+            std::string want = argv[++i];
+            if (want != "avx512" && want != "avx2" && want != "portable") {
+                std::cerr << "unknown --isa " << want << " (expected avx512, avx2 or portable)" << std::endl;
+                return 1;
+            }
+            Isa requested = want == "avx512" ? Isa::Avx512 : want == "avx2" ? Isa::Avx2 : Isa::Portable;
+            if (requested > isa) {
+                std::cerr << "--isa " << want << " is not available on this CPU" << std::endl;
+                return 1;
+            }
+            isa = requested;
+        } else if (strcmp(argv[i], "--placement") == 0 && i + 1 < argc) {
+            ++i;
+        } else if (strcmp(argv[i], "--thread-stats") != 0) {
+            const char* const* flag = std::find_if(std::begin(avx512_only_flags), std::end(avx512_only_flags),
+                                                   [&](const char* f) { return strcmp(argv[i], f) == 0; });
+            if (flag == std::end(avx512_only_flags)) { if (!bad_arg) bad_arg = argv[i]; }
+            else if (!avx512_only_flag) avx512_only_flag = *flag;
+        }
+    }
+    if (isa == Isa::Avx512) return run_avx512(argc, argv);
+    if (avx512_only_flag) {
+        std::cerr << avx512_only_flag << " needs AVX-512 (the avx2 and portable paths only solve plain queries)" << std::endl;
+        return 1;
+    }
+    if (bad_arg) {
+        std::cerr << "bad argument " << bad_arg << " (unknown option or missing value)" << std::endl;
+        return 1;
+    }
+    return isa == Isa::Avx2 ? solve_stdin(search_md5_48_fallback<Md5Avx2Kernel>)
+                            : solve_stdin(search_md5_48_fallback<Md5PortableKernel>);
+}
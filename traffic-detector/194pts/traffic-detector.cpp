@@ -9,33 +9,104 @@
 #include <omp.h>
 #include <numeric>
 #include <unordered_map>
+#include <memory>
+#include <functional>
+#include <immintrin.h>
+#include <chrono>
+#include <cerrno>
+#include <cmath>
+#include <climits>
 
 #include <fcntl.h>
 #include <unistd.h>
+#include <poll.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 
-// --- Custom Hash Table (Linear Probing) ---
-// This custom map is generally faster than std::unordered_map due to simpler implementation.
+// Spreads a std::hash value over all bits; the tables take their tag from the low bits
+// and the position from the bits above it.
+inline size_t mix_hash(size_t h) {
+    h *= 0x9E3779B97F4A7C15ull;
+    return h ^ (h >> 32);
+}
+
+// --- Custom Hash Table (Swiss-table style) ---
+// Open addressing with one control byte per slot, kept apart from the keys and values:
+// the byte holds 7 bits of the hash for a full slot, or marks it empty or deleted. A
+// lookup compares a whole group of 16 control bytes against the tag with SSE2 and only
+// touches the keys whose tag matches, so the table can run at 7/8 load. The first group
+// is mirrored past the end of the control array so that group loads never wrap.
 template<typename Key, typename Value>
 class FastMap {
 private:
-    struct Entry {
-        Key key;
-        Value value;
-        bool occupied = false;
-    };
-    std::vector<Entry> table;
+    static constexpr size_t group_width = 16;
+    static constexpr int8_t ctrl_empty = -128;
+    static constexpr int8_t ctrl_deleted = -2;
+
+    std::vector<int8_t> ctrl; // table_size + group_width bytes
+    std::vector<Key> keys;
+    std::vector<Value> values;
     size_t table_size;
     size_t num_elements = 0;
+    size_t num_deleted = 0;
     std::hash<Key> hasher;
 
+    // Bit i is set when byte i of the group at pos equals tag.
+    uint32_t match(size_t pos, int8_t tag) const {
+        const __m128i group = _mm_loadu_si128((const __m128i*)(ctrl.data() + pos));
+        return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(tag)));
+    }
+    // Bit i is set when slot pos+i is empty or deleted (both have the top bit set).
+    uint32_t match_free(size_t pos) const {
+        return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(ctrl.data() + pos)));
+    }
+
+    void set_ctrl(size_t index, int8_t c) {
+        ctrl[index] = c;
+        if (index < group_width) ctrl[table_size + index] = c;
+    }
+
+    // Index of the slot holding key, or table_size. Groups are visited in a quadratic
+    // sequence (steps of 1, 2, 3... groups), which covers the whole table.
+    size_t find_index(const Key& key, size_t h) const {
+        const size_t mask = table_size - 1;
+        const int8_t tag = (int8_t)(h & 0x7F);
+        size_t pos = (h >> 7) & mask;
+        for (size_t step = group_width;; step += group_width) {
+            for (uint32_t m = match(pos, tag); m; m &= m - 1) {
+                size_t index = (pos + __builtin_ctz(m)) & mask;
+                if (keys[index] == key) return index;
+            }
+            if (match(pos, ctrl_empty)) return table_size;
+            pos = (pos + step) & mask;
+        }
+    }
+
+    size_t find_free(size_t h) const {
+        const size_t mask = table_size - 1;
+        size_t pos = (h >> 7) & mask;
+        for (size_t step = group_width;; step += group_width) {
+            if (uint32_t m = match_free(pos)) return (pos + __builtin_ctz(m)) & mask;
+            pos = (pos + step) & mask;
+        }
+    }
+
+    void allocate(size_t size) {
+        table_size = size;
+        ctrl.assign(table_size + group_width, ctrl_empty);
+        keys.assign(table_size, Key());
+        values.assign(table_size, Value());
+        num_elements = 0;
+        num_deleted = 0;
+    }
+
 public:
     FastMap(size_t initial_capacity = 1024) {
         // Ensure capacity is a power of two for fast modulo
-        table_size = 1;
-        while(table_size < initial_capacity) table_size <<= 1;
-        table.resize(table_size);
+        size_t size = group_width;
+        while (size < initial_capacity) size <<= 1;
+        allocate(size);
     }
 
     // FIX 2: Add size() method
@@ -49,62 +120,85 @@ public:
     }
 
     Value& operator[](const Key& key) {
-        size_t index = hasher(key) & (table_size - 1);
-        while (table[index].occupied && !(table[index].key == key)) {
-            index = (index + 1) & (table_size - 1);
-        }
-
-        if (table[index].occupied) { // Key found
-            return table[index].value;
-        } else { // New key, needs insertion
-            // OPTIMIZATION: Check for rehash only on insertion, not on every access.
-            if (num_elements * 2 > table_size) {
-                rehash();
-                // After rehash, find the new index for the key.
-                index = hasher(key) & (table_size - 1);
-                while (table[index].occupied && !(table[index].key == key)) {
-                    index = (index + 1) & (table_size - 1);
-                }
-            }
-            table[index].key = key;
-            table[index].occupied = true;
-            // Default-initialize the value. Assumes Value is default-constructible.
-            table[index].value = Value{}; 
-            num_elements++;
-            return table[index].value;
-        }
+        size_t h = mix_hash(hasher(key));
+        size_t index = find_index(key, h);
+        if (index != table_size) return values[index]; // Key found
+
+        // New key, needs insertion. Deleted slots count as used until the next rehash.
+        if ((num_elements + num_deleted + 1) * 8 > table_size * 7) rehash(num_elements * 16 > table_size * 7 ? table_size * 2 : table_size);
+        index = find_free(h);
+        if (ctrl[index] == ctrl_deleted) num_deleted--;
+        set_ctrl(index, (int8_t)(h & 0x7F));
+        keys[index] = key;
+        values[index] = Value{};
+        num_elements++;
+        return values[index];
+    }
+
+    // Grows the table at most once so that n elements fit without further rehashing.
+    void reserve(size_t n) {
+        size_t size = table_size;
+        while (n * 8 > size * 7) size <<= 1;
+        if (size != table_size) rehash(size);
+    }
+
+    // Returns the value stored for key, or nullptr.
+    Value* find(const Key& key) {
+        size_t index = find_index(key, mix_hash(hasher(key)));
+        return index != table_size ? &values[index] : nullptr;
+    }
+
+    // Leaves a tombstone, so probe sequences running through the slot stay intact.
+    bool erase(const Key& key) {
+        size_t index = find_index(key, mix_hash(hasher(key)));
+        if (index == table_size) return false;
+        set_ctrl(index, ctrl_deleted);
+        num_elements--;
+        num_deleted++;
+        return true;
     }
 
     // Custom iterator support to allow range-based for loops
+    struct Slot {
+        const Key& key;
+        Value& value;
+    };
     struct Iterator {
-        Entry* ptr;
-        Entry* end;
-        void operator++() { 
-            ptr++;
-            while(ptr < end && !ptr->occupied) ptr++;
-        }
-        bool operator!=(const Iterator& other) const { return ptr != other.ptr; }
-        Entry& operator*() { return *ptr; }
+        FastMap* map;
+        size_t index;
+        void operator++() {
+            index++;
+            while (index < map->table_size && map->ctrl[index] < 0) index++;
+        }
+        bool operator!=(const Iterator& other) const { return index != other.index; }
+        Slot operator*() const { return {map->keys[index], map->values[index]}; }
     };
-    Iterator begin() { 
-        Entry* p = table.data();
-        Entry* e = table.data() + table_size;
-        while(p < e && !p->occupied) p++;
-        return {p, e};
+    Iterator begin() {
+        size_t index = 0;
+        while (index < table_size && ctrl[index] < 0) index++;
+        return {this, index};
     }
-    Iterator end() { return {table.data() + table_size, table.data() + table_size}; }
+    Iterator end() { return {this, table_size}; }
 
 
 private:
-    void rehash() {
-        std::vector<Entry> old_table = std::move(table);
-        table_size *= 2;
-        table.assign(table_size, Entry());
-        num_elements = 0;
-        for (const auto& entry : old_table) {
-            if (entry.occupied) {
-                (*this)[entry.key] = entry.value;
-            }
+    // Moves every element into a table of new_size slots, dropping the tombstones;
+    // on insertion the table doubles, or keeps its size when tombstones made up much
+    // of the load.
+    void rehash(size_t new_size) {
+        std::vector<int8_t> old_ctrl = std::move(ctrl);
+        std::vector<Key> old_keys = std::move(keys);
+        std::vector<Value> old_values = std::move(values);
+        const size_t old_size = table_size;
+        allocate(new_size);
+        for (size_t i = 0; i < old_size; ++i) {
+            if (old_ctrl[i] < 0) continue;
+            size_t h = mix_hash(hasher(old_keys[i]));
+            size_t index = find_free(h);
+            set_ctrl(index, (int8_t)(h & 0x7F));
+            keys[index] = old_keys[i];
+            values[index] = old_values[i];
+            num_elements++;
         }
     }
 };
@@ -132,11 +226,127 @@ template <> struct hash<TCPKey> {
 };
 }
 
+// --- Compact flow table ---
+// The flow map proper: a Swiss-style table like FastMap, but the flow state lives in the
+// control byte next to the hash fingerprint, so a slot is one control byte plus a dense
+// 12-byte key and an update touches no value array. Control byte layout: bit 7 set for
+// an empty slot; otherwise bits 5-6 hold the state (1=SYN-only, 2=Established) and
+// bits 0-4 a 5-bit fingerprint. Flows are never removed, so there are no tombstones.
+class FlowTable {
+private:
+    static constexpr size_t group_width = 16;
+    static constexpr int8_t ctrl_empty = -128;
+    static constexpr int8_t fingerprint_mask = 0x1F;
+    static constexpr int state_shift = 5;
+
+    std::vector<int8_t> ctrl; // table_size + group_width bytes, first group mirrored
+    std::vector<TCPKey> keys;
+    size_t table_size;
+    size_t num_elements = 0;
+    std::hash<TCPKey> hasher;
+
+    void set_ctrl(size_t index, int8_t c) {
+        ctrl[index] = c;
+        if (index < group_width) ctrl[table_size + index] = c;
+    }
+
+    void allocate(size_t size) {
+        table_size = size;
+        ctrl.assign(table_size + group_width, ctrl_empty);
+        keys.assign(table_size, TCPKey());
+        num_elements = 0;
+    }
+
+    void rehash(size_t new_size) {
+        std::vector<int8_t> old_ctrl = std::move(ctrl);
+        std::vector<TCPKey> old_keys = std::move(keys);
+        const size_t old_size = table_size;
+        allocate(new_size);
+        const size_t mask = table_size - 1;
+        for (size_t i = 0; i < old_size; ++i) {
+            if (old_ctrl[i] < 0) continue;
+            size_t pos = (mix_hash(hasher(old_keys[i])) >> state_shift) & mask;
+            for (size_t step = group_width;; step += group_width) {
+                uint32_t free = (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(ctrl.data() + pos)));
+                if (free) {
+                    size_t index = (pos + __builtin_ctz(free)) & mask;
+                    set_ctrl(index, old_ctrl[i]); // fingerprint and state move as they are
+                    keys[index] = old_keys[i];
+                    num_elements++;
+                    break;
+                }
+                pos = (pos + step) & mask;
+            }
+        }
+    }
+
+public:
+    FlowTable(size_t initial_capacity = 1024) {
+        size_t size = group_width;
+        while (size < initial_capacity) size <<= 1;
+        allocate(size);
+    }
+
+    size_t size() const { return num_elements; }
+    bool empty() const { return num_elements == 0; }
+
+    // Grows the table at most once so that n flows fit without further rehashing.
+    void reserve(size_t n) {
+        size_t size = table_size;
+        while (n * 8 > size * 7) size <<= 1;
+        if (size != table_size) rehash(size);
+    }
+
+    // Applies one packet to its flow: a new flow starts SYN-only on a SYN and
+    // Established otherwise; a SYN-only flow becomes Established on any other packet.
+    void update(const TCPKey& key, bool is_syn) {
+        const size_t h = mix_hash(hasher(key));
+        const int8_t fingerprint = (int8_t)(h & fingerprint_mask);
+        const size_t mask = table_size - 1;
+        size_t pos = (h >> state_shift) & mask;
+        for (size_t step = group_width;; step += group_width) {
+            const __m128i group = _mm_loadu_si128((const __m128i*)(ctrl.data() + pos));
+            // Keeping bit 7 in the mask stops empty slots from matching.
+            const __m128i tags = _mm_and_si128(group, _mm_set1_epi8((int8_t)(0x80 | fingerprint_mask)));
+            for (uint32_t m = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(tags, _mm_set1_epi8(fingerprint))); m; m &= m - 1) {
+                size_t index = (pos + __builtin_ctz(m)) & mask;
+                if (keys[index] == key) {
+                    if (!is_syn && (ctrl[index] >> state_shift) == 1) set_ctrl(index, (int8_t)((2 << state_shift) | fingerprint));
+                    return;
+                }
+            }
+            if (uint32_t free = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(ctrl_empty)))) {
+                if ((num_elements + 1) * 8 > table_size * 7) {
+                    rehash(table_size * 2);
+                    update(key, is_syn);
+                    return;
+                }
+                size_t index = (pos + __builtin_ctz(free)) & mask;
+                set_ctrl(index, (int8_t)(((is_syn ? 1 : 2) << state_shift) | fingerprint));
+                keys[index] = key;
+                num_elements++;
+                return;
+            }
+            pos = (pos + step) & mask;
+        }
+    }
+
+    // Calls f(key, state) for every flow.
+    template <typename F>
+    void for_each(F f) const {
+        for (size_t i = 0; i < table_size; ++i) {
+            if (ctrl[i] >= 0) f(keys[i], ctrl[i] >> state_shift);
+        }
+    }
+};
+
 // OPTIMIZATION 1 (MAJOR): Define a compact struct to hold parsed data.
 // This struct will be passed to worker threads, eliminating the need for re-parsing.
 struct ParsedData {
     bool is_tcp;
+    bool is_icmp; // only produced when a rule asks for ICMP; otherwise !is_tcp means DNS
     uint32_t src_ip;
+    uint32_t ts; // whole seconds of the timestamp field
     union {
         struct { // TCP specific info
             uint32_t dst_ip;
@@ -146,10 +356,40 @@ struct ParsedData {
         } tcp;
         struct { // DNS specific info
             uint16_t prefix_len;
+            uint16_t label_entropy; // only filled in when a rule asks for it
         } dns;
+        struct { // ICMP specific info
+            uint32_t dst_ip;
+        } icmp;
     };
 };
 
+// What the detector rules read beyond the core fields. The parser only does the extra
+// work for the bits set in parser_interest, the union of the active rules' interests.
+enum RuleInterest : unsigned {
+    interest_tcp = 1,
+    interest_dns = 2,
+    interest_icmp = 4,          // ICMP lines become records instead of being dropped
+    interest_label_entropy = 8, // dns.label_entropy
+};
+static unsigned parser_interest = 0;
+
+// Shannon entropy of the bytes of [p, p + len), in hundredths of a bit per byte.
+inline uint16_t label_entropy(const char* p, size_t len) {
+    if (len == 0) return 0;
+    uint32_t counts[256] = {};
+    for (size_t i = 0; i < len; ++i) counts[(uint8_t)p[i]]++;
+    double sum = 0;
+    for (size_t i = 0; i < len; ++i) {
+        uint32_t& c = counts[(uint8_t)p[i]];
+        if (c) {
+            sum += c * std::log2((double)c);
+            c = 0;
+        }
+    }
+    return (uint16_t)((std::log2((double)len) - sum / len) * 100 + 0.5);
+}
+
 
 // OPTIMIZATION 1: Modify parser to perform a full parse and populate the ParsedData struct.
 inline bool full_parser(std::string_view line, ParsedData& out) {
@@ -158,8 +398,10 @@ inline bool full_parser(std::string_view line, ParsedData& out) {
     uint32_t temp_ip = 0, part = 0;
     uint16_t temp_port = 0;
 
+    out.ts = 0; while (p < end && *p >= '0' && *p <= '9') out.ts = out.ts * 10 + (*p++ - '0');
     while (p < end && *p != ' ') p++; if (p == end) return false; p++;
     out.is_tcp = (*p == 'T');
+    out.is_icmp = (parser_interest & interest_icmp) && *p == 'I';
     while (p < end && *p != ' ') p++; if (p == end) return false; p++;
 
     for (int i = 0; i < 4; ++i) { part = 0; while (p < end && *p >= '0' && *p <= '9') part = part * 10 + (*p++ - '0'); temp_ip = (temp_ip << 8) | part; if (p < end && *p == '.') p++; }
@@ -169,6 +411,10 @@ inline bool full_parser(std::string_view line, ParsedData& out) {
     temp_ip = 0;
     for (int i = 0; i < 4; ++i) { part = 0; while (p < end && *p >= '0' && *p <= '9') part = part * 10 + (*p++ - '0'); temp_ip = (temp_ip << 8) | part; if (p < end && *p == '.') p++; }
     uint32_t dst_ip_val = temp_ip;
+    if (out.is_icmp) {
+        out.icmp.dst_ip = dst_ip_val;
+        return true;
+    }
     if (p == end) return false; p++;
     
     temp_port = 0; while (p < end && *p >= '0' && *p <= '9') temp_port = temp_port * 10 + (*p++ - '0');
@@ -190,167 +436,1040 @@ inline bool full_parser(std::string_view line, ParsedData& out) {
         const char* dot = (const char*)memchr(domain_start, '.', end - domain_start);
         size_t prefix_len = (dot == nullptr) ? (end - domain_start) : (dot - domain_start);
         out.dns.prefix_len = prefix_len;
+        if (parser_interest & interest_label_entropy) out.dns.label_entropy = label_entropy(domain_start, prefix_len);
+    }
+    return true;
+}
+
+// --- SIMD structural scanner ---
+// In the style of simdjson's first stage: every 64-byte block of the input is compared
+// against '\n' and ' ' at once, giving one bit per byte, and the parser walks the set
+// bits instead of the bytes. Fields are then converted knowing their exact extent:
+// dotted quads with one shuffle and two multiply-adds, ports with SWAR arithmetic.
+// full_parser stays the fallback for lines the fast path does not cover.
+struct SeparatorMasks {
+    uint64_t newline;
+    uint64_t space;
+};
+
+inline SeparatorMasks scan_block(const char* p) {
+#if defined(__AVX512BW__)
+    const __m512i v = _mm512_loadu_si512(p);
+    return {_mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('\n')), _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8(' '))};
+#elif defined(__AVX2__)
+    const __m256i lo = _mm256_loadu_si256((const __m256i*)p);
+    const __m256i hi = _mm256_loadu_si256((const __m256i*)(p + 32));
+    auto mask = [&](char c) {
+        const __m256i cv = _mm256_set1_epi8(c);
+        return (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, cv)) |
+               (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, cv)) << 32;
+    };
+    return {mask('\n'), mask(' ')};
+#else
+    SeparatorMasks m = {0, 0};
+    for (int i = 0; i < 64; ++i) {
+        m.newline |= (uint64_t)(p[i] == '\n') << i;
+        m.space |= (uint64_t)(p[i] == ' ') << i;
+    }
+    return m;
+#endif
+}
+
+#ifdef __SSSE3__
+// Shuffle per octet-length combination (1-3 digits each, 81 in all) that moves octet k
+// right-aligned into bytes 4k..4k+2 and zeroes the rest.
+struct DottedQuadTable {
+    alignas(16) uint8_t shuffle[81][16];
+    DottedQuadTable() {
+        for (int idx = 0; idx < 81; ++idx) {
+            int len[4] = {idx / 27 % 3 + 1, idx / 9 % 3 + 1, idx / 3 % 3 + 1, idx % 3 + 1};
+            int start = 0;
+            for (int k = 0; k < 4; ++k) {
+                for (int j = 0; j < 4; ++j) {
+                    int digit = j - (3 - len[k]);
+                    shuffle[idx][4 * k + j] = (j < 3 && digit >= 0) ? (uint8_t)(start + digit) : 0x80;
+                }
+                start += len[k] + 1;
+            }
+        }
     }
+};
+static const DottedQuadTable dotted_quad_table;
+#endif
+
+// Parses a dotted quad of len bytes at p; 16 bytes must be readable. Returns false
+// when the field is not four octets of 0-255 with 1-3 digits each.
+inline bool parse_dotted_quad(const char* p, size_t len, uint32_t& ip) {
+#ifdef __SSSE3__
+    if (len < 7 || len > 15) return false;
+    const __m128i v = _mm_sub_epi8(_mm_loadu_si128((const __m128i*)p), _mm_set1_epi8('0'));
+    uint32_t dots = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('.' - '0'))) & ((1u << len) - 1);
+    if (__builtin_popcount(dots) != 3) return false;
+    const __m128i non_digit = _mm_or_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(9)), _mm_cmplt_epi8(v, _mm_setzero_si128()));
+    if ((uint32_t)_mm_movemask_epi8(non_digit) & ((1u << len) - 1) & ~dots) return false;
+    const unsigned d0 = __builtin_ctz(dots); dots &= dots - 1;
+    const unsigned d1 = __builtin_ctz(dots); dots &= dots - 1;
+    const unsigned d2 = __builtin_ctz(dots);
+    const unsigned l0 = d0, l1 = d1 - d0 - 1, l2 = d2 - d1 - 1, l3 = (unsigned)len - d2 - 1;
+    if (l0 - 1 > 2 || l1 - 1 > 2 || l2 - 1 > 2 || l3 - 1 > 2) return false;
+    const int idx = (((l0 - 1) * 3 + (l1 - 1)) * 3 + (l2 - 1)) * 3 + (l3 - 1);
+    const __m128i digits = _mm_shuffle_epi8(v, _mm_load_si128((const __m128i*)dotted_quad_table.shuffle[idx]));
+    const __m128i pairs = _mm_maddubs_epi16(digits, _mm_setr_epi8(100, 10, 1, 0, 100, 10, 1, 0, 100, 10, 1, 0, 100, 10, 1, 0));
+    const __m128i octets = _mm_madd_epi16(pairs, _mm_set1_epi16(1));
+    if (_mm_movemask_epi8(_mm_cmpgt_epi32(octets, _mm_set1_epi32(255)))) return false;
+    ip = (uint32_t)_mm_cvtsi128_si32(_mm_shuffle_epi8(octets, _mm_setr_epi8(12, 8, 4, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)));
+    return true;
+#else
+    (void)p; (void)len; (void)ip;
+    return false;
+#endif
+}
+
+// Parses a 1-5 digit decimal of len bytes at p; 8 bytes must be readable. Returns false
+// on anything but digits. The digits are shifted to the top of a little-endian word and
+// combined pairwise (SWAR).
+inline bool parse_port(const char* p, size_t len, uint16_t& port) {
+    if (len < 1 || len > 5) return false;
+    uint64_t x;
+    memcpy(&x, p, 8);
+    const uint64_t low7 = x & 0x7F7F7F7F7F7F7F7Full;
+    const uint64_t non_digit = ((low7 + 0x4646464646464646ull) | ~(low7 + 0x5050505050505050ull) | x) & 0x8080808080808080ull;
+    if (non_digit << (8 * (8 - len))) return false;
+    x = (x - 0x3030303030303030ull) << (8 * (8 - len)); // borrows from later bytes are shifted out
+    x = (x * 10 + (x >> 8)) & 0x00FF00FF00FF00FFull;
+    x = (x * 100 + (x >> 16)) & 0x0000FFFF0000FFFFull;
+    port = (uint16_t)(x * 10000 + (x >> 32));
     return true;
 }
 
+// Parses the line [line, end) whose first space positions are sp[0..n_spaces).
+inline bool parse_line(const char* line, const char* end, const char* const sp[7], int n_spaces, const char* buffer_end, ParsedData& out) {
+    // Fast path: all seven separators are known and the fields can be over-read. ICMP
+    // lines, when asked for, are left to full_parser.
+    if (n_spaces == 7 && buffer_end - sp[5] >= 16 && !((parser_interest & interest_icmp) && sp[0][1] == 'I')) {
+        const bool is_tcp = sp[0][1] == 'T';
+        uint32_t src_ip, dst_ip;
+        uint16_t src_port, dst_port;
+        if (parse_dotted_quad(sp[1] + 1, sp[2] - sp[1] - 1, src_ip) && parse_dotted_quad(sp[2] + 1, sp[3] - sp[2] - 1, dst_ip) &&
+            parse_port(sp[3] + 1, sp[4] - sp[3] - 1, src_port) && parse_port(sp[4] + 1, sp[5] - sp[4] - 1, dst_port)) {
+            out.is_tcp = is_tcp;
+            out.is_icmp = false;
+            out.src_ip = src_ip;
+            out.ts = 0;
+            for (const char* t = line; t < sp[0] && *t >= '0' && *t <= '9'; ++t) out.ts = out.ts * 10 + (*t - '0');
+            if (is_tcp) {
+                out.tcp.dst_ip = dst_ip;
+                out.tcp.src_port = src_port;
+                out.tcp.dst_port = dst_port;
+                out.tcp.is_syn = sp[6] - sp[5] == 4 && sp[5][1] == 'S' && sp[5][2] == 'Y' && sp[5][3] == 'N';
+            } else {
+                const char* domain_start = sp[6] + 1;
+                const char* dot = (const char*)memchr(domain_start, '.', end - domain_start);
+                out.dns.prefix_len = (dot == nullptr) ? (end - domain_start) : (dot - domain_start);
+                if (parser_interest & interest_label_entropy) out.dns.label_entropy = label_entropy(domain_start, out.dns.prefix_len);
+            }
+            return true;
+        }
+    }
+    return full_parser({line, (size_t)(end - line)}, out);
+}
+
+// Parses every line of [begin, end) and calls emit(record) for each valid one. The
+// slice starts at a line start; bytes past buffer_end are never read.
+template <typename Emit>
+void scan_lines(const char* begin, const char* end, const char* buffer_end, Emit emit) {
+    const char* line = begin;
+    const char* sp[7];
+    int n_spaces = 0;
+    ParsedData p_data;
+    for (const char* block = begin; block < end; block += 64) {
+        SeparatorMasks m;
+        if (buffer_end - block >= 64) {
+            m = scan_block(block);
+        } else {
+            alignas(64) char pad[64] = {};
+            memcpy(pad, block, buffer_end - block);
+            m = scan_block(pad);
+        }
+        if (end - block < 64) {
+            const uint64_t keep = (1ull << (end - block)) - 1;
+            m.newline &= keep;
+            m.space &= keep;
+        }
+        for (uint64_t seps = m.newline | m.space; seps != 0; seps &= seps - 1) {
+            const int bit = __builtin_ctzll(seps);
+            const char* pos = block + bit;
+            if ((m.newline >> bit) & 1) {
+                if (parse_line(line, pos, sp, n_spaces, buffer_end, p_data)) emit(p_data);
+                line = pos + 1;
+                n_spaces = 0;
+            } else if (n_spaces < 7) {
+                sp[n_spaces++] = pos;
+            }
+        }
+    }
+    if (line < end && parse_line(line, end, sp, n_spaces, buffer_end, p_data)) emit(p_data);
+}
+
+// --- Time-windowed detection ---
+// For long captures the whole-input maps grow without bound. In windowed mode each
+// owner thread keeps a flow only while it is active: a flow idle for idle_timeout
+// seconds of log time is evicted, and if it never got past its SYN it counts as a
+// portscan probe in the window where it expired. Tunnelling bytes count in the window
+// of the query. Expiry uses a hashed timer wheel of one-second slots: every flow has
+// exactly one entry, in the slot of its deadline at the time it was filed; when the
+// slot comes up the entry is either evicted or refiled at its current deadline, so
+// refreshing a flow on every packet costs nothing.
+struct FlowTimer {
+    char state; // 0=new, 1=SYN-only, 2=Established
+    uint32_t last_seen;
+};
+
+struct WindowCounts {
+    uint32_t window; // index: first second is window * window_secs
+    FastMap<uint32_t, long long> portscan{64};
+    FastMap<uint32_t, long long> tunnelling{64};
+};
+
+class WindowedDetector {
+private:
+    static constexpr uint32_t wheel_slots = 4096; // deadlines further out wait whole turns
+    uint32_t window_secs, idle_timeout;
+    FastMap<TCPKey, FlowTimer> flows;
+    std::vector<std::vector<TCPKey>> wheel;
+    std::vector<TCPKey> due;
+    WindowCounts current;
+    std::vector<WindowCounts> closed_windows; // oldest first
+    uint32_t now = 0;
+    bool started = false;
+
+    void close_window() {
+        if (!current.portscan.empty() || !current.tunnelling.empty()) closed_windows.push_back(std::move(current));
+        current = WindowCounts();
+    }
+
+    void expire_slot(uint32_t second) {
+        due.swap(wheel[second % wheel_slots]);
+        for (const TCPKey& key : due) {
+            FlowTimer* flow = flows.find(key);
+            uint64_t deadline = (uint64_t)flow->last_seen + idle_timeout;
+            if (deadline <= second) {
+                if (flow->state == 1) current.portscan[key.src_ip]++;
+                flows.erase(key);
+            } else {
+                wheel[deadline % wheel_slots].push_back(key);
+            }
+        }
+        due.clear();
+    }
+
+public:
+    WindowedDetector(uint32_t window_secs, uint32_t idle_timeout)
+        : window_secs(window_secs), idle_timeout(idle_timeout), wheel(wheel_slots) {}
+
+    void reserve_flows(size_t n) { flows.reserve(flows.size() + n); }
+    uint32_t window_length() const { return window_secs; }
+    uint32_t clock() const { return now; }
+    uint32_t current_window() const { return current.window; }
+    std::vector<WindowCounts>& closed() { return closed_windows; }
+
+    // Moves log time forward to t one second at a time, expiring flows and closing
+    // windows on the way. Once no flow is left, the rest of a gap is skipped.
+    void advance_to(uint32_t t) {
+        if (!started) {
+            started = true;
+            now = t;
+            current.window = t / window_secs;
+            return;
+        }
+        while (now < t) {
+            if (flows.empty()) now = t - 1;
+            uint32_t second = now + 1;
+            if (second / window_secs != current.window) {
+                close_window();
+                current.window = second / window_secs;
+            }
+            expire_slot(second);
+            now = second;
+        }
+    }
+
+    void process(const ParsedData* records, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            const ParsedData& p_data = records[i];
+            advance_to(p_data.ts); // out-of-order records count at the current time
+            if (p_data.is_tcp) {
+                TCPKey key = {p_data.src_ip, p_data.tcp.dst_ip, p_data.tcp.src_port, p_data.tcp.dst_port};
+                FlowTimer& flow = flows[key];
+                if (flow.state == 0) { // New flow
+                    flow.state = p_data.tcp.is_syn ? 1 : 2;
+                    wheel[(now + idle_timeout) % wheel_slots].push_back(key);
+                } else if (flow.state == 1 && !p_data.tcp.is_syn) { // SYN-only flow sees another packet
+                    flow.state = 2;
+                }
+                flow.last_seen = now;
+            } else if (!p_data.is_icmp && p_data.dns.prefix_len >= 30) {
+                current.tunnelling[p_data.src_ip] += p_data.dns.prefix_len;
+            }
+        }
+    }
+
+    // End of input: every remaining flow is decided in the current window.
+    void finish() {
+        for (const auto& entry : flows) if (entry.value.state == 1) current.portscan[entry.key.src_ip]++;
+        flows = FastMap<TCPKey, FlowTimer>();
+        for (auto& slot : wheel) slot.clear();
+        close_window();
+    }
+};
+
+// --- Detector rules ---
+// Detections beyond portscan and tunnelling are rules. Each owner thread holds its own
+// instance of every active rule and feeds it the records it owns, during the same pass
+// that updates the core maps, so a rule never causes another pass over the input. A
+// rule keeps per-key state in thread-local tables and reports (ip, value) pairs; the
+// pairs of all threads are summed per IP, and IPs reaching the rule's threshold are
+// reported under its name. Because TCP records are partitioned by flow and the others
+// by source, a rule keyed by TCP destination sees partial counts, which is why the
+// values must be additive.
+class Rule {
+public:
+    virtual ~Rule() = default;
+    virtual void on_tcp(const ParsedData&) {}
+    virtual void on_dns(const ParsedData&) {}
+    virtual void on_icmp(const ParsedData&) {}
+    virtual void for_each_count(const std::function<void(uint32_t, long long)>& emit) = 0;
+    virtual void clear() = 0;
+};
+
+// SYN packets per destination: a flood shows up as a destination receiving far more
+// connection attempts over the capture than anything else.
+class SynFloodRule : public Rule {
+private:
+    FastMap<uint32_t, long long> syns;
+
+public:
+    void on_tcp(const ParsedData& p_data) override {
+        if (p_data.tcp.is_syn) syns[p_data.tcp.dst_ip]++;
+    }
+    void for_each_count(const std::function<void(uint32_t, long long)>& emit) override {
+        for (const auto& entry : syns) emit(entry.key, entry.value);
+    }
+    void clear() override { syns = FastMap<uint32_t, long long>(); }
+};
+
+// DNS queries per source whose first label looks random: at least min_label bytes and
+// an entropy of at least min_entropy hundredths of a bit per byte.
+class DnsEntropyRule : public Rule {
+private:
+    static constexpr uint16_t min_label = 8;
+    uint16_t min_entropy;
+    FastMap<uint32_t, long long> hits;
+
+public:
+    explicit DnsEntropyRule(uint16_t min_entropy) : min_entropy(min_entropy) {}
+    void on_dns(const ParsedData& p_data) override {
+        if (p_data.dns.prefix_len >= min_label && p_data.dns.label_entropy >= min_entropy) hits[p_data.src_ip]++;
+    }
+    void for_each_count(const std::function<void(uint32_t, long long)>& emit) override {
+        for (const auto& entry : hits) emit(entry.key, entry.value);
+    }
+    void clear() override { hits = FastMap<uint32_t, long long>(); }
+};
+
+// Distinct ICMP destinations per source. ICMP is partitioned by source, so each
+// source's set of destinations lives in one thread.
+class IcmpSweepRule : public Rule {
+private:
+    FastMap<uint64_t, char> seen; // (source << 32) | destination
+    FastMap<uint32_t, long long> targets;
+
+public:
+    void on_icmp(const ParsedData& p_data) override {
+        const uint64_t pair = (uint64_t)p_data.src_ip << 32 | p_data.icmp.dst_ip;
+        char& known = seen[pair];
+        if (!known) {
+            known = 1;
+            targets[p_data.src_ip]++;
+        }
+    }
+    void for_each_count(const std::function<void(uint32_t, long long)>& emit) override {
+        for (const auto& entry : targets) emit(entry.key, entry.value);
+    }
+    void clear() override {
+        seen = FastMap<uint64_t, char>();
+        targets = FastMap<uint32_t, long long>();
+    }
+};
+
+// The rules a command-line option turns on. The option takes one number: the
+// threshold for the reported value, or for dnsentropy the bits per byte that make a
+// label random (every source with such a query is then reported).
+struct RuleSpec {
+    const char* option;
+    const char* name; // type column of the report
+    unsigned interest;
+    Rule* (*make)(double param);
+    long long (*min_report)(double param);
+};
+
+static const RuleSpec rule_specs[] = {
+    {"--syn-flood", "synflood", interest_tcp,
+     [](double) -> Rule* { return new SynFloodRule; }, [](double n) { return (long long)n; }},
+    {"--dns-entropy", "dnsentropy", interest_dns | interest_label_entropy,
+     [](double bits) -> Rule* { return new DnsEntropyRule((uint16_t)(bits * 100 + 0.5)); }, [](double) { return 1LL; }},
+    {"--icmp-sweep", "icmpsweep", interest_icmp,
+     [](double) -> Rule* { return new IcmpSweepRule; }, [](double n) { return (long long)n; }},
+};
+
+struct ActiveRule {
+    const RuleSpec* spec;
+    double param;
+};
+
+// One thread's instances of the active rules, indexed like the active list, with the
+// rules that want each record kind listed separately for dispatch.
+class RuleSet {
+private:
+    std::vector<std::unique_ptr<Rule>> rules;
+    std::vector<Rule*> tcp_rules, dns_rules, icmp_rules;
+
+public:
+    void add(const ActiveRule& active) {
+        Rule* rule = active.spec->make(active.param);
+        rules.emplace_back(rule);
+        if (active.spec->interest & interest_tcp) tcp_rules.push_back(rule);
+        if (active.spec->interest & (interest_dns | interest_label_entropy)) dns_rules.push_back(rule);
+        if (active.spec->interest & interest_icmp) icmp_rules.push_back(rule);
+    }
+    bool empty() const { return rules.empty(); }
+    Rule& operator[](size_t i) { return *rules[i]; }
+
+    void on_record(const ParsedData& p_data) {
+        if (p_data.is_tcp) {
+            for (Rule* rule : tcp_rules) rule->on_tcp(p_data);
+        } else if (p_data.is_icmp) {
+            for (Rule* rule : icmp_rules) rule->on_icmp(p_data);
+        } else {
+            for (Rule* rule : dns_rules) rule->on_dns(p_data);
+        }
+    }
+    void clear() {
+        for (auto& rule : rules) rule->clear();
+    }
+};
+
 struct ThreadData {
-    FastMap<TCPKey, char> flow_map; // TCP flow state: 0=new, 1=SYN-only, 2=Established
+    FlowTable flow_map; // TCP flow state: 1=SYN-only, 2=Established
     FastMap<uint32_t, long long> dnstunnel_count;
+    std::unique_ptr<WindowedDetector> windowed; // set in windowed mode, replacing the two maps
+    RuleSet rules;
+
+    // Forgets everything seen so far, keeping the active rules.
+    void clear() {
+        flow_map = FlowTable();
+        dnstunnel_count = FastMap<uint32_t, long long>();
+        rules.clear();
+    }
+
+    // Makes room for new_flows more flows and new_sources more tunnelling sources; the
+    // estimates may include keys already present, which only over-reserves.
+    void reserve(size_t new_flows, size_t new_sources) {
+        if (windowed) {
+            windowed->reserve_flows(new_flows);
+        } else {
+            flow_map.reserve(flow_map.size() + new_flows);
+            dnstunnel_count.reserve(dnstunnel_count.size() + new_sources);
+        }
+    }
+};
+
+// --- Per-destination append buffers ---
+// Each parsing thread appends a record to the chain of the thread that owns its flow
+// (or DNS source). Chains are lists of fixed-size blocks, so appends never move data
+// and the owner reads the blocks in place; no line is parsed twice.
+struct RecordBlock {
+    static constexpr size_t capacity = 4096;
+    size_t count = 0;
+    ParsedData records[capacity];
+};
+
+class BlockChain {
+private:
+    std::vector<std::unique_ptr<RecordBlock>> blocks;
+    size_t used = 0; // blocks[0, used) hold records; the rest are kept for reuse
+    RecordBlock* tail = nullptr;
+
+public:
+    void push(const ParsedData& p_data) {
+        if (!tail || tail->count == RecordBlock::capacity) {
+            if (used == blocks.size()) blocks.emplace_back(new RecordBlock); // records left uninitialized
+            tail = blocks[used++].get();
+            tail->count = 0;
+        }
+        tail->records[tail->count++] = p_data;
+    }
+    // Empties the chain but keeps its blocks, so streaming input allocates them once.
+    void clear() {
+        used = 0;
+        tail = nullptr;
+    }
+    size_t num_blocks() const { return used; }
+    const RecordBlock& block(size_t i) const { return *blocks[i]; }
+};
+
+// --- Cardinality estimation ---
+// A HyperLogLog sketch (Flajolet et al.) with 2^10 one-byte registers, about 3% standard
+// error. The parsing threads fill one per destination thread while partitioning; the
+// owner merges the sketches addressed to it and sizes its maps once from the estimate
+// instead of doubling its way up.
+class CardinalitySketch {
+private:
+    static constexpr int precision = 10;
+    static constexpr size_t num_registers = size_t(1) << precision;
+    uint8_t registers[num_registers];
+
+public:
+    CardinalitySketch() { clear(); }
+    void clear() { memset(registers, 0, sizeof(registers)); }
+
+    void add(uint64_t h) {
+        // MurmurHash3 finalizer: the callers' hashes are weak in some bits (the IP hash
+        // is the identity).
+        h ^= h >> 33; h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33; h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        const size_t index = h >> (64 - precision);
+        const uint8_t rank = (uint8_t)(__builtin_clzll((h << precision) | (uint64_t(1) << (precision - 1))) + 1);
+        if (rank > registers[index]) registers[index] = rank;
+    }
+
+    void merge(const CardinalitySketch& other) {
+        for (size_t i = 0; i < num_registers; ++i) registers[i] = std::max(registers[i], other.registers[i]);
+    }
+
+    size_t estimate() const {
+        double sum = 0;
+        size_t zeros = 0;
+        for (size_t i = 0; i < num_registers; ++i) {
+            sum += std::ldexp(1.0, -registers[i]);
+            zeros += registers[i] == 0;
+        }
+        const double m = (double)num_registers;
+        double e = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+        if (e <= 2.5 * m && zeros) e = m * std::log(m / zeros); // linear counting for small sets
+        return (size_t)e;
+    }
+};
+
+// What one parsing thread sends to one owner thread.
+struct Outbox {
+    BlockChain records;
+    CardinalitySketch flows;
+    CardinalitySketch dns_sources; // only sources of queries that reach dnstunnel_count
 };
 
-// OPTIMIZATION 1: Worker function now processes a vector of ParsedData structs. No parsing needed here.
-void worker_func(const std::vector<ParsedData>& assigned_data, ThreadData& data) {
-    for (const auto& p_data : assigned_data) {
+// Worker function processes parsed records in place. No parsing needed here.
+void worker_func(const ParsedData* records, size_t count, ThreadData& data) {
+    for (size_t i = 0; i < count; ++i) {
+        const ParsedData& p_data = records[i];
         if (p_data.is_tcp) {
             TCPKey key = {p_data.src_ip, p_data.tcp.dst_ip, p_data.tcp.src_port, p_data.tcp.dst_port};
-            char& state = data.flow_map[key];
-            if (state == 0) { // New flow
-                state = p_data.tcp.is_syn ? 1 : 2;
-            } else if (state == 1 && !p_data.tcp.is_syn) { // SYN-only flow sees another packet
-                state = 2;
-            }
-        } else { // is DNS
+            data.flow_map.update(key, p_data.tcp.is_syn);
+        } else if (!p_data.is_icmp) { // is DNS
             if (p_data.dns.prefix_len >= 30) {
                 data.dnstunnel_count[p_data.src_ip] += p_data.dns.prefix_len;
             }
         }
+        if (!data.rules.empty()) data.rules.on_record(p_data);
     }
 }
 
 
-int main() {
-    std::ios_base::sync_with_stdio(false);
-    
-    int fd = STDIN_FILENO;
-    struct stat sb;
-    fstat(fd, &sb);
-    size_t file_size = sb.st_size;
-    if (file_size == 0) return 0;
-    const char* buffer = (const char*)mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
-    
-    const int num_threads = std::thread::hardware_concurrency();
-    std::vector<ThreadData> thread_data(num_threads);
-    // OPTIMIZATION 1: This vector will hold parsed data structs, not string_views.
-    std::vector<std::vector<ParsedData>> thread_parsed_data(num_threads);
+// Returns the first line start at or after pos.
+inline size_t align_to_line(const char* buffer, size_t size, size_t pos) {
+    while (pos > 0 && pos < size && buffer[pos - 1] != '\n') pos++;
+    return pos;
+}
 
+// Parses the complete lines of [buffer, buffer + size) and folds every record into the
+// state of the thread that owns it. Ownership depends only on the flow (or DNS source),
+// so calling this on consecutive pieces of a stream gives the same state as one call on
+// the whole input. Bytes up to buffer_end may be over-read by the parser.
+void process_span(const char* buffer, size_t size, const char* buffer_end,
+                  std::vector<ThreadData>& thread_data, std::vector<std::vector<Outbox>>& outbox) {
+    const int num_threads = (int)thread_data.size();
+    uint32_t latest = 0;
     std::hash<TCPKey> tcp_hasher;
     std::hash<uint32_t> ip_hasher;
 
-    // --- PASS 1: Parallel Count (Parse once) ---
-    std::vector<std::vector<size_t>> counts(num_threads, std::vector<size_t>(num_threads, 0));
     #pragma omp parallel num_threads(num_threads)
     {
+        // --- PHASE 1: Parallel Parse and Partition (each line parsed once) ---
         int tid = omp_get_thread_num();
-        size_t chunk_size = file_size / num_threads;
-        size_t start_pos = tid * chunk_size;
-        size_t end_pos = (tid == num_threads - 1) ? file_size : (tid + 1) * chunk_size;
-        if (tid > 0 && start_pos > 0) while (start_pos < file_size && buffer[start_pos - 1] != '\n') start_pos++;
-        if (tid < num_threads - 1 && end_pos < file_size) while (end_pos < file_size && buffer[end_pos - 1] != '\n') end_pos++;
-        const char* ptr = buffer + start_pos;
-        const char* const chunk_end = buffer + end_pos;
-        
-        ParsedData p_data;
-        while (ptr < chunk_end) {
-            const char* line_end = (const char*)memchr(ptr, '\n', chunk_end - ptr);
-            if (!line_end) line_end = chunk_end;
-            if (full_parser({ptr, (size_t)(line_end - ptr)}, p_data)) {
-                if (p_data.is_tcp) {
-                    TCPKey key = {p_data.src_ip, p_data.tcp.dst_ip, p_data.tcp.src_port, p_data.tcp.dst_port};
-                    counts[tid][tcp_hasher(key) % num_threads]++;
-                } else {
-                    counts[tid][ip_hasher(p_data.src_ip) % num_threads]++;
-                }
+        size_t start_pos = align_to_line(buffer, size, size * tid / num_threads);
+        size_t end_pos = align_to_line(buffer, size, size * (tid + 1) / num_threads);
+        std::vector<Outbox>& my_outbox = outbox[tid];
+        for (auto& box : my_outbox) {
+            box.records.clear();
+            box.flows.clear();
+            box.dns_sources.clear();
+        }
+
+        scan_lines(buffer + start_pos, buffer + end_pos, buffer_end, [&](const ParsedData& p_data) {
+            if (p_data.is_tcp) {
+                TCPKey key = {p_data.src_ip, p_data.tcp.dst_ip, p_data.tcp.src_port, p_data.tcp.dst_port};
+                const size_t h = tcp_hasher(key);
+                Outbox& box = my_outbox[h % num_threads];
+                box.records.push(p_data);
+                box.flows.add(h);
+            } else {
+                const size_t h = ip_hasher(p_data.src_ip);
+                Outbox& box = my_outbox[h % num_threads];
+                box.records.push(p_data);
+                if (!p_data.is_icmp && p_data.dns.prefix_len >= 30) box.dns_sources.add(h);
+            }
+        });
+
+        #pragma omp barrier
+
+        // --- PHASE 2: Parallel Lock-Free Processing of owned records ---
+        // Size the maps once for everything addressed to this thread.
+        ThreadData& data = thread_data[tid];
+        CardinalitySketch flows, dns_sources;
+        for (int src = 0; src < num_threads; ++src) {
+            flows.merge(outbox[src][tid].flows);
+            dns_sources.merge(outbox[src][tid].dns_sources);
+        }
+        data.reserve(flows.estimate() * 9 / 8, dns_sources.estimate() * 9 / 8);
+
+        for (int src = 0; src < num_threads; ++src) {
+            const BlockChain& chain = outbox[src][tid].records;
+            for (size_t b = 0; b < chain.num_blocks(); ++b) {
+                if (data.windowed) data.windowed->process(chain.block(b).records, chain.block(b).count);
+                else worker_func(chain.block(b).records, chain.block(b).count, data);
             }
-            ptr = line_end + 1;
+        }
+
+        // Bring every owner to the newest log time seen, so that all windows before
+        // the current one are complete everywhere.
+        if (data.windowed) {
+            #pragma omp barrier
+            #pragma omp single
+            for (const auto& other : thread_data) latest = std::max(latest, other.windowed->clock());
+            data.windowed->advance_to(latest);
         }
     }
+}
 
-    // --- Inter-Pass: Calculate Offsets and Allocate ---
-    std::vector<std::vector<size_t>> write_offsets(num_threads, std::vector<size_t>(num_threads));
-    for (int dest_tid = 0; dest_tid < num_threads; ++dest_tid) {
-        size_t current_offset = 0;
-        for (int src_tid = 0; src_tid < num_threads; ++src_tid) {
-            write_offsets[src_tid][dest_tid] = current_offset;
-            current_offset += counts[src_tid][dest_tid];
+// --- Result aggregation ---
+// Reports list IPs in the string order of their dotted quads. That order compares the
+// octets as strings one after another ('.' and the end of the string sort below every
+// digit), so mapping each octet to the rank of its decimal string among "0".."255"
+// gives a 32-bit key whose numeric order is the report order. Counts are merged and
+// sorted on that key; strings are only produced when the report is written.
+struct OctetOrder {
+    uint8_t rank[256];  // octet -> position of its decimal string
+    uint8_t octet[256]; // inverse
+    OctetOrder() {
+        std::vector<std::pair<std::string, int>> names;
+        for (int i = 0; i < 256; ++i) names.emplace_back(std::to_string(i), i);
+        std::sort(names.begin(), names.end());
+        for (int r = 0; r < 256; ++r) {
+            rank[names[r].second] = (uint8_t)r;
+            octet[r] = (uint8_t)names[r].second;
         }
-        thread_parsed_data[dest_tid].resize(current_offset);
     }
-    
-    // --- PASS 2: Parallel Scatter (Scatter parsed structs) ---
+};
+static const OctetOrder octet_order;
+
+inline uint32_t report_key(uint32_t ip) {
+    return (uint32_t)octet_order.rank[ip >> 24] << 24 | (uint32_t)octet_order.rank[(ip >> 16) & 0xFF] << 16 |
+           (uint32_t)octet_order.rank[(ip >> 8) & 0xFF] << 8 | octet_order.rank[ip & 0xFF];
+}
+
+inline uint32_t ip_from_report_key(uint32_t key) {
+    return (uint32_t)octet_order.octet[key >> 24] << 24 | (uint32_t)octet_order.octet[(key >> 16) & 0xFF] << 16 |
+           (uint32_t)octet_order.octet[(key >> 8) & 0xFF] << 8 | octet_order.octet[key & 0xFF];
+}
+
+struct IpCount {
+    uint32_t key; // report_key of the IP
+    long long count;
+};
+
+// Merges the (ip, count) pairs that for_each_count(tid, emit) produces for every thread
+// into one list sorted in report order, summing the counts of repeated IPs. Each
+// thread scatters its pairs into 256 partitions by the top key byte (the first octet's
+// rank), then the partitions are sorted and reduced in parallel; since the partitions
+// are already in key order, concatenating them finishes the sort.
+template <typename ForEachCount>
+std::vector<IpCount> aggregate_by_ip(int num_threads, ForEachCount for_each_count) {
+    constexpr int num_parts = 256;
+    std::vector<std::vector<std::vector<IpCount>>> parts(num_threads, std::vector<std::vector<IpCount>>(num_parts));
+    std::vector<std::vector<IpCount>> merged(num_parts);
+    std::vector<size_t> offsets(num_parts + 1, 0);
+    std::vector<IpCount> result;
+
     #pragma omp parallel num_threads(num_threads)
     {
-        int tid = omp_get_thread_num();
-        size_t chunk_size = file_size / num_threads;
-        size_t start_pos = tid * chunk_size;
-        size_t end_pos = (tid == num_threads - 1) ? file_size : (tid + 1) * chunk_size;
-        if (tid > 0 && start_pos > 0) while (start_pos < file_size && buffer[start_pos - 1] != '\n') start_pos++;
-        if (tid < num_threads - 1 && end_pos < file_size) while (end_pos < file_size && buffer[end_pos - 1] != '\n') end_pos++;
-        const char* ptr = buffer + start_pos;
-        const char* const chunk_end = buffer + end_pos;
-        
-        ParsedData p_data;
-        while (ptr < chunk_end) {
-            const char* line_end = (const char*)memchr(ptr, '\n', chunk_end - ptr);
-            if (!line_end) line_end = chunk_end;
-            if (full_parser({ptr, (size_t)(line_end - ptr)}, p_data)) {
-                 if (p_data.is_tcp) {
-                    TCPKey key = {p_data.src_ip, p_data.tcp.dst_ip, p_data.tcp.src_port, p_data.tcp.dst_port};
-                    size_t dest_tid = tcp_hasher(key) % num_threads;
-                    thread_parsed_data[dest_tid][write_offsets[tid][dest_tid]++] = p_data;
-                } else {
-                    size_t dest_tid = ip_hasher(p_data.src_ip) % num_threads;
-                    thread_parsed_data[dest_tid][write_offsets[tid][dest_tid]++] = p_data;
-                }
+        const int tid = omp_get_thread_num();
+        std::vector<std::vector<IpCount>>& my_parts = parts[tid];
+        for_each_count(tid, [&](uint32_t ip, long long count) {
+            const uint32_t key = report_key(ip);
+            my_parts[key >> 24].push_back({key, count});
+        });
+
+        #pragma omp barrier
+
+        #pragma omp for schedule(dynamic)
+        for (int p = 0; p < num_parts; ++p) {
+            std::vector<IpCount>& out = merged[p];
+            for (int t = 0; t < num_threads; ++t) out.insert(out.end(), parts[t][p].begin(), parts[t][p].end());
+            std::sort(out.begin(), out.end(), [](const IpCount& a, const IpCount& b) { return a.key < b.key; });
+            size_t n = 0;
+            for (size_t i = 0; i < out.size(); ++i) {
+                if (n > 0 && out[n - 1].key == out[i].key) out[n - 1].count += out[i].count;
+                else out[n++] = out[i];
             }
-            ptr = line_end + 1;
+            out.resize(n);
+        }
+
+        #pragma omp single
+        {
+            for (int p = 0; p < num_parts; ++p) offsets[p + 1] = offsets[p] + merged[p].size();
+            result.resize(offsets[num_parts]);
+        }
+
+        #pragma omp for schedule(dynamic)
+        for (int p = 0; p < num_parts; ++p) std::copy(merged[p].begin(), merged[p].end(), result.begin() + offsets[p]);
+    }
+    return result;
+}
+
+// --- Output with Optimized Sorting ---
+// Lines are formatted in parallel: each thread writes a contiguous range of the sorted
+// counts into its own buffer with table lookups instead of sprintf (octets from a
+// 256-entry table, counts two digits at a time), and writev emits the buffers in order.
+struct DecimalTables {
+    char octet_text[256][4]; // digits, then the length in the last byte
+    char digit_pairs[200];   // "00" "01" ... "99"
+    DecimalTables() {
+        for (int i = 0; i < 256; ++i) {
+            int len = sprintf(octet_text[i], "%d", i);
+            octet_text[i][3] = (char)len;
+        }
+        for (int i = 0; i < 100; ++i) {
+            digit_pairs[2 * i] = (char)('0' + i / 10);
+            digit_pairs[2 * i + 1] = (char)('0' + i % 10);
         }
     }
+};
+static const DecimalTables decimal_tables;
+
+inline char* format_ip(char* out, uint32_t ip) {
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        const char* text = decimal_tables.octet_text[(ip >> shift) & 0xFF];
+        memcpy(out, text, 4); // copies the length byte too; it is overwritten next
+        out += text[3];
+        *out++ = '.';
+    }
+    return out - 1;
+}
 
-    // --- PHASE 3: Parallel Lock-Free Processing (No parsing here) ---
-    #pragma omp parallel for num_threads(num_threads)
-    for (int i = 0; i < num_threads; ++i) {
-        worker_func(thread_parsed_data[i], thread_data[i]);
+inline char* format_count(char* out, unsigned long long v) {
+    char digits[20];
+    char* p = digits + sizeof(digits);
+    while (v >= 100) {
+        p -= 2;
+        memcpy(p, decimal_tables.digit_pairs + 2 * (v % 100), 2);
+        v /= 100;
+    }
+    if (v >= 10) {
+        p -= 2;
+        memcpy(p, decimal_tables.digit_pairs + 2 * v, 2);
+    } else {
+        *--p = (char)('0' + v);
+    }
+    const size_t len = digits + sizeof(digits) - p;
+    memcpy(out, p, len);
+    return out + len;
+}
+
+// Writes all of the buffers, in order, with as few writev calls as the kernel allows.
+void write_buffers(std::vector<struct iovec>& iov) {
+    size_t first = 0;
+    while (first < iov.size()) {
+        const int n = (int)std::min<size_t>(iov.size() - first, IOV_MAX);
+        ssize_t written = writev(STDOUT_FILENO, iov.data() + first, n);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        while (first < iov.size() && (size_t)written >= iov[first].iov_len) written -= iov[first++].iov_len;
+        if (first < iov.size()) {
+            iov[first].iov_base = (char*)iov[first].iov_base + written;
+            iov[first].iov_len -= written;
+        }
+    }
+}
+
+void print_counts(const char* type, const std::vector<IpCount>& counts) {
+    if (counts.empty()) return;
+    const size_t type_len = strlen(type);
+    // An output line is at most 15 (IP) + 1 + type_len + 1 + 20 (count) + 1 bytes.
+    const size_t max_line = type_len + 38;
+    const int num_threads = std::max(1, std::min<int>(omp_get_max_threads(), (int)(counts.size() >> 12)));
+    std::vector<std::vector<char>> buffers(num_threads);
+    std::vector<struct iovec> iov(num_threads);
+
+    #pragma omp parallel num_threads(num_threads)
+    {
+        const int tid = omp_get_thread_num();
+        const size_t begin = counts.size() * tid / num_threads;
+        const size_t end = counts.size() * (tid + 1) / num_threads;
+        std::vector<char>& buffer = buffers[tid];
+        buffer.resize((end - begin) * max_line);
+        char* out = buffer.data();
+        for (size_t i = begin; i < end; ++i) {
+            out = format_ip(out, ip_from_report_key(counts[i].key));
+            *out++ = ' ';
+            memcpy(out, type, type_len);
+            out += type_len;
+            *out++ = ' ';
+            out = format_count(out, (unsigned long long)counts[i].count); // counts are never negative
+            *out++ = '\n';
+        }
+        iov[tid] = {buffer.data(), (size_t)(out - buffer.data())};
+    }
+
+    fflush(stdout); // window headers go through stdio
+    write_buffers(iov);
+}
+
+// Prints, oldest first, every closed window before `until` merged over the owner
+// threads, each under a "window <start> <end>" line, and drops them.
+void print_windows(std::vector<ThreadData>& thread_data, uint32_t until) {
+    const int num_threads = (int)thread_data.size();
+    const uint32_t window_secs = thread_data[0].windowed->window_length();
+    std::vector<uint32_t> windows;
+    for (auto& data : thread_data)
+        for (const auto& counts : data.windowed->closed()) if (counts.window < until) windows.push_back(counts.window);
+    std::sort(windows.begin(), windows.end());
+    windows.erase(std::unique(windows.begin(), windows.end()), windows.end());
+
+    std::vector<size_t> next(num_threads, 0);
+    for (uint32_t window : windows) {
+        // This window's counts from each thread, if it has any.
+        std::vector<WindowCounts*> parts(num_threads, nullptr);
+        for (int t = 0; t < num_threads; ++t) {
+            auto& closed = thread_data[t].windowed->closed();
+            if (next[t] < closed.size() && closed[next[t]].window == window) parts[t] = &closed[next[t]++];
+        }
+        auto portscan = aggregate_by_ip(num_threads, [&](int t, auto emit) {
+            if (parts[t]) for (const auto& entry : parts[t]->portscan) emit(entry.key, entry.value);
+        });
+        auto tunnelling = aggregate_by_ip(num_threads, [&](int t, auto emit) {
+            if (parts[t]) for (const auto& entry : parts[t]->tunnelling) emit(entry.key, entry.value);
+        });
+        printf("window %llu %llu\n", (unsigned long long)window * window_secs, ((unsigned long long)window + 1) * window_secs);
+        print_counts("portscan", portscan);
+        print_counts("tunnelling", tunnelling);
+    }
+    for (int t = 0; t < num_threads; ++t) {
+        auto& closed = thread_data[t].windowed->closed();
+        closed.erase(closed.begin(), closed.begin() + next[t]);
+    }
+    fflush(stdout);
+}
+
+// Merges the per-thread state and prints the portscan and tunnelling reports; in
+// windowed mode, decides the remaining flows and prints the windows not yet printed.
+void print_report(std::vector<ThreadData>& thread_data, const std::vector<ActiveRule>& active_rules) {
+    if (thread_data[0].windowed) {
+        for (auto& data : thread_data) data.windowed->finish();
+        print_windows(thread_data, UINT32_MAX);
+        return;
     }
 
     // --- AGGREGATION ---
-    // OPTIMIZATION: Use FastMap for final aggregation as well.
-    FastMap<uint32_t, long long> dnstunnel_final_count(1 << 16);
-    FastMap<uint32_t, long long> portscan_final_count(1 << 16);
-    
-    for(auto& data : thread_data) {
-        for(auto& entry : data.dnstunnel_count) dnstunnel_final_count[entry.key] += entry.value;
-        for(auto& entry : data.flow_map) if(entry.value == 1) portscan_final_count[entry.key.src_ip]++;
-    }
-
-    // --- Output with Optimized Sorting ---
-    auto format_and_print = [](const std::string& type, auto& counts) {
-        if (counts.empty()) return;
-        std::vector<std::pair<std::string, long long>> sorted_counts;
-        sorted_counts.reserve(counts.size());
-        char ip_buf[16];
-        for (const auto& entry : counts) {
-            uint32_t ip_int = entry.key;
-            long long count = entry.value;
-            sprintf(ip_buf, "%u.%u.%u.%u", (ip_int >> 24) & 0xFF, (ip_int >> 16) & 0xFF, (ip_int >> 8) & 0xFF, ip_int & 0xFF);
-            sorted_counts.emplace_back(ip_buf, count);
-        }
-        std::sort(sorted_counts.begin(), sorted_counts.end()); // Default pair sort is lexicographical on first element
-        std::string out_buffer;
-        out_buffer.reserve(sorted_counts.size() * 60);
-        char line_buf[128];
-        for (const auto& [ip_str, count] : sorted_counts) {
-            int len = sprintf(line_buf, "%s %s %lld\n", ip_str.c_str(), type.c_str(), count);
-            out_buffer.append(line_buf, len);
-        }
-        fwrite(out_buffer.data(), 1, out_buffer.size(), stdout);
+    const int num_threads = (int)thread_data.size();
+    auto portscan = aggregate_by_ip(num_threads, [&](int t, auto emit) {
+        thread_data[t].flow_map.for_each([&](const TCPKey& key, int state) { if (state == 1) emit(key.src_ip, 1); });
+    });
+    auto tunnelling = aggregate_by_ip(num_threads, [&](int t, auto emit) {
+        for (const auto& entry : thread_data[t].dnstunnel_count) emit(entry.key, entry.value);
+    });
+
+    print_counts("portscan", portscan);
+    print_counts("tunnelling", tunnelling);
+
+    for (size_t r = 0; r < active_rules.size(); ++r) {
+        auto counts = aggregate_by_ip(num_threads, [&](int t, auto emit) {
+            thread_data[t].rules[r].for_each_count(emit);
+        });
+        const long long min_report = active_rules[r].spec->min_report(active_rules[r].param);
+        counts.erase(std::remove_if(counts.begin(), counts.end(), [&](const IpCount& c) { return c.count < min_report; }), counts.end());
+        print_counts(active_rules[r].spec->name, counts);
+    }
+    fflush(stdout);
+}
+
+// --- Streaming input ---
+// Pipes (tail -f | ./solution) have no size to mmap, so stdin is read in chunks into a
+// fixed buffer. Complete lines go through process_span; the partial last line is moved
+// to the front and completed by the next read. With a report interval, a report is
+// printed every interval_ms of wall time and the detector state is reset, so memory
+// stays bounded by one window's flows. Each such report is preceded by an
+// "interval N START_MS END_MS" line giving the wall-clock span since the stream
+// started; the last interval ends at EOF. Otherwise a single report is printed at EOF,
+// identical to the mmap path. In windowed mode, each log-time window is printed as soon
+// as the input has moved past it.
+constexpr size_t stream_buffer_size = 1 << 22;
+
+void run_streaming(int fd, std::vector<ThreadData>& thread_data, std::vector<std::vector<Outbox>>& outbox, int interval_ms,
+                   const std::vector<ActiveRule>& active_rules) {
+    std::vector<char> buffer(stream_buffer_size);
+    size_t filled = 0;
+    bool skipping = false; // inside a line longer than the whole buffer; it is dropped
+    bool eof = false;
+    const auto stream_start = std::chrono::steady_clock::now();
+    auto deadline = stream_start + std::chrono::milliseconds(interval_ms);
+    unsigned long long interval_index = 0, interval_start_ms = 0;
+
+    auto print_interval_header = [&]() {
+        auto now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - stream_start).count();
+        printf("interval %llu %llu %llu\n", interval_index, interval_start_ms, (unsigned long long)now_ms);
+        interval_start_ms = now_ms;
+        ++interval_index;
     };
+    auto end_window = [&]() {
+        print_interval_header();
+        print_report(thread_data, active_rules);
+        for (auto& data : thread_data) data.clear();
+        deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(interval_ms);
+    };
+
+    while (!eof) {
+        // Read what is available, without waiting once the buffer holds something.
+        bool got_data = false;
+        while (filled < buffer.size()) {
+            int timeout = -1;
+            if (got_data) {
+                timeout = 0;
+            } else if (interval_ms > 0) {
+                auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+                timeout = (int)std::max<long long>(left, 0);
+            }
+            struct pollfd pfd = {fd, POLLIN, 0};
+            int ready = poll(&pfd, 1, timeout);
+            if (ready < 0 && errno == EINTR) continue;
+            if (ready == 0) break;
+            ssize_t n = read(fd, buffer.data() + filled, buffer.size() - filled);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) { eof = true; break; }
+            filled += n;
+            got_data = true;
+        }
+
+        // Hand the complete lines on; everything is complete at EOF.
+        size_t complete = filled;
+        if (!eof) {
+            const char* last_newline = (const char*)memrchr(buffer.data(), '\n', filled);
+            complete = last_newline ? last_newline - buffer.data() + 1 : 0;
+        }
+        size_t start = 0;
+        if (skipping && complete > 0) {
+            const char* newline = (const char*)memchr(buffer.data(), '\n', complete);
+            start = newline ? newline - buffer.data() + 1 : complete;
+            skipping = false;
+        }
+        if (complete > start) {
+            process_span(buffer.data() + start, complete - start, buffer.data() + filled, thread_data, outbox);
+            if (thread_data[0].windowed) print_windows(thread_data, thread_data[0].windowed->current_window());
+        }
+        if (complete == 0 && filled == buffer.size()) {
+            skipping = true;
+            complete = filled;
+        }
+        memmove(buffer.data(), buffer.data() + complete, filled - complete);
+        filled -= complete;
 
-    format_and_print("portscan", portscan_final_count);
-    format_and_print("tunnelling", dnstunnel_final_count);
+        if (interval_ms > 0 && std::chrono::steady_clock::now() >= deadline) end_window();
+    }
+    if (interval_ms > 0) print_interval_header();
+    print_report(thread_data, active_rules);
+}
+
+int main(int argc, char** argv) {
+    std::ios_base::sync_with_stdio(false);
+
+    // --stream forces chunked reading even for regular files; --interval SECONDS prints
+    // a report per window of wall time while streaming. --window SECONDS reports per
+    // window of log time instead, expiring flows idle for --idle-timeout SECONDS
+    // (default: the window length). Each option in rule_specs turns on a detector rule;
+    // rules are not windowed.
+    bool force_stream = false;
+    int interval_ms = 0;
+    uint32_t window_secs = 0, idle_timeout = 0;
+    bool usage_error = false;
+    std::vector<ActiveRule> active_rules;
+    for (int i = 1; i < argc && !usage_error; ++i) {
+        const RuleSpec* rule = nullptr;
+        for (const RuleSpec& spec : rule_specs) if (strcmp(argv[i], spec.option) == 0) rule = &spec;
+        if (rule && i + 1 < argc) {
+            active_rules.push_back({rule, atof(argv[++i])});
+            parser_interest |= rule->interest;
+        } else if (strcmp(argv[i], "--stream") == 0) {
+            force_stream = true;
+        } else if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc) {
+            interval_ms = (int)(atof(argv[++i]) * 1000);
+        } else if (strcmp(argv[i], "--window") == 0 && i + 1 < argc) {
+            window_secs = (uint32_t)strtoul(argv[++i], nullptr, 10);
+            usage_error = window_secs == 0;
+        } else if (strcmp(argv[i], "--idle-timeout") == 0 && i + 1 < argc) {
+            idle_timeout = (uint32_t)strtoul(argv[++i], nullptr, 10);
+            usage_error = idle_timeout == 0;
+        } else {
+            usage_error = true;
+        }
+    }
+    if (usage_error || (idle_timeout && !window_secs) || (window_secs && (interval_ms || !active_rules.empty()))) {
+        fprintf(stderr, "usage: %s [--stream] [--interval SECONDS | --window SECONDS [--idle-timeout SECONDS]]\n"
+                        "       [--syn-flood MIN_SYNS] [--dns-entropy BITS_PER_BYTE] [--icmp-sweep MIN_TARGETS]\n", argv[0]);
+        return 1;
+    }
+    
+    const int num_threads = std::thread::hardware_concurrency();
+    std::vector<ThreadData> thread_data(num_threads);
+    if (window_secs) {
+        for (auto& data : thread_data) data.windowed.reset(new WindowedDetector(window_secs, idle_timeout ? idle_timeout : window_secs));
+    }
+    for (auto& data : thread_data)
+        for (const ActiveRule& active : active_rules) data.rules.add(active);
+    // outbox[src][dest]: records parsed by thread src for owner thread dest.
+    std::vector<std::vector<Outbox>> outbox(num_threads);
+    for (auto& row : outbox) row.resize(num_threads);
+
+    int fd = STDIN_FILENO;
+    struct stat sb;
+    const char* buffer = (const char*)MAP_FAILED;
+    size_t file_size = 0;
+    if (!force_stream && interval_ms == 0 && fstat(fd, &sb) == 0 && S_ISREG(sb.st_mode)) {
+        file_size = sb.st_size;
+        if (file_size == 0) return 0;
+        buffer = (const char*)mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    if (buffer == MAP_FAILED) {
+        run_streaming(fd, thread_data, outbox, interval_ms, active_rules);
+        return 0;
+    }
+
+    process_span(buffer, file_size, buffer + file_size, thread_data, outbox);
+    print_report(thread_data, active_rules);
 
     munmap((void*)buffer, file_size);
     close(fd);
 
     return 0;
-}
\ No newline at end of file
+}